@@ -0,0 +1,405 @@
+// --- Z-Td-bench：核心任务操作的性能基准 ---
+// 生成 1k / 100k / 1M 条的合成任务列表，对加载、保存、搜索 (倒排索引 / 模糊匹配)、日期筛选、到期提醒、清理已完成、拖动排序
+// 分别计时，并记录峰值 RSS 和分配次数。默认用 offscreen 平台插件，无需显示器。
+//
+// 用法：Z-Td-bench [--sizes 1000,100000,1000000] [--json 结果.json]  (可读的表格打在 stderr 上)
+// --json 输出机器可读的结果 (每个操作一条)，方便在版本之间对比回归。
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QListView>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "reminderscheduler.h"
+#include "taskbinaryfile.h"
+#include "taskdateindex.h"
+#include "taskfiltermodel.h"
+#include "taskfuzzysearch.h"
+#include "taskjournal.h"
+#include "taskmodel.h"
+#include "tasksearchindex.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// ================= 分配计数 =================
+// 替换全局 operator new 统计调用次数。Qt 容器的数据块走 malloc，不在这里面，
+// 所以另外用 glibc 的 mallinfo2 报告堆上净增的字节数 (其他平台报 -1)。
+
+static std::atomic<quint64> newCalls{0};
+
+void *operator new(std::size_t size) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static qint64 peakRssKb() {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return -1;
+    return static_cast<qint64>(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return -1;
+#if defined(Q_OS_MACOS)
+    return ru.ru_maxrss / 1024; // macOS 上单位是字节
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static qint64 heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return static_cast<qint64>(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+// ================= 计时框架 =================
+
+struct BenchResult {
+    QString op;
+    int tasks = 0;
+    int iterations = 0;
+    double msPerIteration = 0;
+    qint64 peakRssKb = 0;     // 操作结束时进程的峰值 RSS
+    qint64 peakGrowthKb = 0;  // 这次操作把峰值抬高了多少
+    double newCalls = 0;      // 每次迭代的 operator new 次数
+    qint64 heapDeltaBytes = 0; // 每次迭代结束时堆上净增 (不支持时为 -1)
+};
+
+struct MemoryResult {
+    int tasks = 0;
+    qint64 modelBytes = 0; // TaskModel::memoryUsage()
+    qint64 heapBytes = 0;  // 建模型前后堆上净增 (不支持时为 -1)
+};
+
+class BenchRunner {
+  public:
+    // setup 不计时；body 计时；iterations 次取平均
+    template <typename Setup, typename Body>
+    void run(const QString &op, int tasks, int iterations, Setup &&setup, Body &&body) {
+        qint64 totalNs = 0;
+        quint64 totalNew = 0;
+        qint64 totalHeap = 0;
+        const qint64 peakBefore = peakRssKb();
+        for (int i = 0; i < iterations; ++i) {
+            setup();
+            const quint64 newBefore = newCalls.load();
+            const qint64 heapBefore = heapInUse();
+            QElapsedTimer timer;
+            timer.start();
+            body();
+            totalNs += timer.nsecsElapsed();
+            totalNew += newCalls.load() - newBefore;
+            totalHeap += heapInUse() - heapBefore;
+        }
+
+        BenchResult r;
+        r.op = op;
+        r.tasks = tasks;
+        r.iterations = iterations;
+        r.msPerIteration = totalNs / 1e6 / iterations;
+        r.peakRssKb = peakRssKb();
+        r.peakGrowthKb = r.peakRssKb - peakBefore;
+        r.newCalls = double(totalNew) / iterations;
+        r.heapDeltaBytes = heapInUse() < 0 ? -1 : totalHeap / iterations;
+        results.append(r);
+
+        QTextStream(stderr) << QString("%1 %2 %3 ms  peak %4 MiB (+%5)  new %6  heap %7 KiB")
+                                   .arg(op, -22)
+                                   .arg(tasks, 8)
+                                   .arg(r.msPerIteration, 10, 'f', 3)
+                                   .arg(r.peakRssKb / 1024)
+                                   .arg(r.peakGrowthKb / 1024)
+                                   .arg(r.newCalls, 0, 'f', 0)
+                                   .arg(r.heapDeltaBytes < 0 ? QString("n/a") : QString::number(r.heapDeltaBytes / 1024))
+                            << Qt::endl;
+    }
+
+    template <typename Body>
+    void run(const QString &op, int tasks, int iterations, Body &&body) {
+        run(op, tasks, iterations, [] {}, std::forward<Body>(body));
+    }
+
+    // build(measured) 建一个模型，趁模型还活着调用 measured(模型自己报告的字节数)，
+    // 同时量一下堆上实际净增了多少 (包括 malloc 的额外开销)
+    template <typename Build>
+    void reportMemory(int tasks, Build &&build) {
+        MemoryResult m;
+        m.tasks = tasks;
+        const qint64 heapBefore = heapInUse();
+        build([&](qint64 modelBytes) {
+            m.modelBytes = modelBytes;
+            m.heapBytes = heapBefore < 0 ? -1 : heapInUse() - heapBefore;
+        });
+        memory.append(m);
+
+        QTextStream(stderr) << QString("%1 %2 model %3 B/task  heap %4 B/task")
+                                   .arg("bytes_per_task", -22)
+                                   .arg(tasks, 8)
+                                   .arg(double(m.modelBytes) / tasks, 0, 'f', 1)
+                                   .arg(m.heapBytes < 0 ? QString("n/a")
+                                                        : QString::number(double(m.heapBytes) / tasks, 'f', 1))
+                            << Qt::endl;
+    }
+
+    QJsonDocument toJson() const {
+        QJsonArray array;
+        for (const BenchResult &r : results) {
+            QJsonObject obj;
+            obj["op"] = r.op;
+            obj["tasks"] = r.tasks;
+            obj["iterations"] = r.iterations;
+            obj["ms"] = r.msPerIteration;
+            obj["peak_rss_kb"] = static_cast<double>(r.peakRssKb);
+            obj["peak_rss_growth_kb"] = static_cast<double>(r.peakGrowthKb);
+            obj["new_calls"] = r.newCalls;
+            obj["heap_delta_bytes"] = static_cast<double>(r.heapDeltaBytes);
+            array.append(obj);
+        }
+        QJsonArray memoryArray;
+        for (const MemoryResult &m : memory) {
+            QJsonObject obj;
+            obj["tasks"] = m.tasks;
+            obj["model_bytes"] = static_cast<double>(m.modelBytes);
+            obj["model_bytes_per_task"] = double(m.modelBytes) / m.tasks;
+            obj["heap_bytes_per_task"] = m.heapBytes < 0 ? -1.0 : double(m.heapBytes) / m.tasks;
+            memoryArray.append(obj);
+        }
+        QJsonObject root;
+        root["benchmark"] = "Z-Td-bench";
+        root["qt"] = qVersion();
+        root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["results"] = array;
+        root["memory"] = memoryArray;
+        return QJsonDocument(root);
+    }
+
+  private:
+    QVector<BenchResult> results;
+    QVector<MemoryResult> memory;
+};
+
+// ================= 合成数据 =================
+
+// 固定种子，每次跑出来的列表都一样
+static QVector<TaskRecord> makeTasks(int count) {
+    static const char *const words[] = {"会议", "周报", "买菜", "电话", "健身", "读书", "报销", "复盘",
+                                        "review", "deploy", "bug", "release", "docs", "email"};
+    const int wordCount = int(sizeof(words) / sizeof(words[0]));
+    QRandomGenerator rng(42);
+    const qint32 today = static_cast<qint32>(QDate::currentDate().toJulianDay());
+
+    QVector<TaskRecord> tasks(count);
+    for (int i = 0; i < count; ++i) {
+        TaskRecord &t = tasks[i];
+        t.title = QString("%1%2 %3 #%4")
+                      .arg(QString::fromUtf8(words[rng.bounded(wordCount)]),
+                           QString::fromUtf8(words[rng.bounded(wordCount)]),
+                           QString::fromUtf8(words[rng.bounded(wordCount)]))
+                      .arg(i);
+        t.day = today - 180 + rng.bounded(360);
+        t.done = rng.bounded(10) == 0; // 大约 10% 已完成，分散在各处
+    }
+    return tasks;
+}
+
+static int iterationsFor(int count) {
+    return count <= 1000 ? 50 : count <= 100000 ? 3 : 1;
+}
+
+// ================= 各项操作 =================
+
+static void benchSize(BenchRunner &bench, int n, const QString &dir) {
+    const QVector<TaskRecord> source = makeTasks(n);
+    TaskTable sourceTable;
+    sourceTable.reserve(n);
+    for (const TaskRecord &task : source)
+        sourceTable.append(task);
+    const int iters = iterationsFor(n);
+    const QString jsonPath = dir + "/bench.json";
+    const QString binPath = dir + "/bench.ztdb";
+
+    // --- 保存 / 加载 ---
+    bench.run("save_json", n, iters, [&] { TaskJournal::writeSnapshot(jsonPath, sourceTable, 1); });
+    bench.run("load_json", n, iters, [&] {
+        TaskTable tasks;
+        quint64 gen = 0;
+        TaskJournal::readSnapshot(jsonPath, tasks, gen);
+    });
+    bench.run("save_binary", n, iters, [&] { TaskJournal::writeSnapshot(binPath, sourceTable, 1); });
+    bench.run("load_binary_mapped", n, iters, [&] {
+        TaskTable tasks;
+        quint64 gen = 0;
+        QSharedPointer<TaskBinaryFile> mapped;
+        TaskJournal::readSnapshot(binPath, tasks, gen, &mapped);
+    });
+
+    // --- 界面相关：模型 + 过滤代理 + 真正的 QListView (offscreen) ---
+    TaskModel model;
+    TaskSearchIndex searchIndex(&model);
+    TaskDateIndex dateIndex(&model);
+    TaskFuzzySearch fuzzySearch(&model);
+    TaskFilterModel filter;
+    filter.setSourceModel(&model);
+    QListView view;
+    view.setUniformItemSizes(true);
+    view.setModel(&filter);
+    view.resize(400, 600);
+    view.show();
+
+    bench.run("set_tasks", n, iters, [&] {
+        model.setTasks(source);
+        view.doItemsLayout();
+    });
+
+    // 每条任务占多少字节：模型自己算的 (表 + 编号对照表) 和堆上实际净增的
+    bench.reportMemory(n, [&](auto measured) {
+        TaskModel fresh;
+        fresh.setTasks(source);
+        fresh.rowForId(0); // 把编号对照表也建出来
+        measured(fresh.memoryUsage());
+    });
+
+    bench.run("search_build_index", n, 1, [&] { searchIndex.search("会议"); });
+
+    // 模拟逐字输入，每次按键：查索引 + 换可见集合 + 重新排版
+    const QStringList keystrokes = {"周", "周报", "周报会", "周报会议", "r", "re", "rev", "revi", "review"};
+    bench.run("search_keystroke", n, keystrokes.size() * iters, [&, k = 0]() mutable {
+        filter.setFilter(searchIndex.search(keystrokes[k++ % keystrokes.size()]));
+        view.doItemsLayout();
+    });
+    filter.clearFilter();
+
+    // 同样的逐字输入走模糊匹配：继续打字只在上次的命中里找，结果按相关度排
+    bench.run("fuzzy_keystroke", n, keystrokes.size() * iters, [&, k = 0]() mutable {
+        filter.setFilter(fuzzySearch.search(keystrokes[k++ % keystrokes.size()]), TaskFilterModel::GivenOrder);
+        view.doItemsLayout();
+    });
+    filter.clearFilter();
+
+    const qint32 today = static_cast<qint32>(QDate::currentDate().toJulianDay());
+    bench.run("date_filter_week", n, iters, [&] {
+        filter.setFilter(dateIndex.query(today, today + 6));
+        view.doItemsLayout();
+    });
+    filter.clearFilter();
+
+    // 提醒：整张表建一次堆，再随机改 1000 条的截止日期 (每次改期在堆里原地调整)
+    ReminderScheduler reminders;
+    bench.run("reminder_attach", n, iters, [&] {
+        reminders.attach(nullptr);
+        reminders.attach(&model);
+    });
+    bench.run("reminder_reschedule_x1000", n, iters, [&] {
+        QRandomGenerator rng(11);
+        for (int i = 0; i < 1000; ++i)
+            model.setDate(rng.bounded(n), TaskRecord::formatDay(today + 1 + rng.bounded(60)));
+    });
+    reminders.attach(nullptr);
+
+    // 1000 次随机的单行拖动
+    bench.run("move_rows_x1000", n, iters, [&] {
+        QRandomGenerator rng(7);
+        for (int i = 0; i < 1000; ++i) {
+            const int from = rng.bounded(n);
+            const int to = rng.bounded(n + 1);
+            filter.moveRows(QModelIndex(), from, 1, QModelIndex(), to);
+        }
+        view.doItemsLayout();
+    });
+    // 最坏情况：每次都拖到同一个缝里，顺序键对半分，挤满了就要把附近重新拉开
+    bench.run("move_same_slot_x1000", n, iters, [&] {
+        for (int i = 0; i < 1000; ++i)
+            filter.moveRows(QModelIndex(), n - 1, 1, QModelIndex(), 1);
+        view.doItemsLayout();
+    });
+
+    bench.run(
+        "clear_completed", n, iters, [&] { model.setTasks(source); },
+        [&] {
+            model.removeDone();
+            view.doItemsLayout();
+        });
+}
+
+int main(int argc, char *argv[]) {
+    // 没指定平台时默认 offscreen，CI 上没有显示器也能跑
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Z-Td core operation benchmarks");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma-separated task counts.", "list", "1000,100000,1000000");
+    QCommandLineOption jsonOption("json", "Write machine-readable results to <file> (- for stdout).", "file");
+    parser.addOption(sizesOption);
+    parser.addOption(jsonOption);
+    parser.process(app);
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qCritical("Z-Td-bench: cannot create a temporary directory");
+        return 1;
+    }
+
+    BenchRunner bench;
+    const QStringList sizes = parser.value(sizesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &size : sizes) {
+        const int n = size.trimmed().toInt();
+        if (n > 0)
+            benchSize(bench, n, dir.path());
+    }
+
+    if (parser.isSet(jsonOption)) {
+        const QByteArray json = bench.toJson().toJson();
+        const QString path = parser.value(jsonOption);
+        if (path == "-") {
+            QTextStream(stdout) << json;
+        } else {
+            QFile out(path);
+            if (!out.open(QIODevice::WriteOnly)) {
+                qCritical("Z-Td-bench: cannot write %s", qPrintable(path));
+                return 1;
+            }
+            out.write(json);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "idlescheduler.h"
+#include <QDateTime>
+#include <QEvent>
+#include <QWidget>
+
+IdleScheduler::IdleScheduler(QWidget *window, QObject *parent) : QObject(parent), window(window) {
+    // 单次触发 + 每次重新对齐：PreciseTimer 保证醒在整秒附近，而不是被系统合并到几十毫秒之后
+    clockTimer = new QTimer(this);
+    clockTimer->setSingleShot(true);
+    clockTimer->setTimerType(Qt::PreciseTimer);
+    connect(clockTimer, &QTimer::timeout, this, &IdleScheduler::clockTick);
+    window->installEventFilter(this);
+    idle = !window->isVisible() || window->isMinimized();
+}
+
+IdleScheduler::~IdleScheduler() {
+    qDeleteAll(pollTasks);
+}
+
+void IdleScheduler::addClockTask(const std::function<void()> &tick) {
+    clockTasks.append(tick);
+    if (!idle && !clockTimer->isActive())
+        scheduleClock();
+}
+
+void IdleScheduler::addPollTask(int intervalMs, const std::function<void()> &poll) {
+    PollTask *task = new PollTask{new QTimer(this), intervalMs, poll, QElapsedTimer()};
+    task->sinceLastRun.start();
+    // 轮询用粗精度定时器即可，系统可以把它和别的唤醒合并
+    task->timer->setTimerType(Qt::VeryCoarseTimer);
+    task->timer->setInterval(intervalMs);
+    connect(task->timer, &QTimer::timeout, this, [task]() {
+        // 恢复时可能只等了剩下的一段，跑过一次之后回到完整间隔
+        if (task->timer->interval() != task->intervalMs)
+            task->timer->setInterval(task->intervalMs);
+        task->sinceLastRun.restart();
+        task->poll();
+    });
+    pollTasks.append(task);
+    if (!idle)
+        task->timer->start();
+}
+
+void IdleScheduler::addSuspendHook(const std::function<void()> &hook) {
+    suspendHooks.append(hook);
+}
+
+void IdleScheduler::addResumeHook(const std::function<void()> &hook) {
+    resumeHooks.append(hook);
+}
+
+bool IdleScheduler::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == window) {
+        switch (event->type()) {
+        case QEvent::Show:
+        case QEvent::Hide:
+        case QEvent::WindowStateChange:
+            updateIdle();
+            break;
+        default:
+            break;
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void IdleScheduler::updateIdle() {
+    const bool nowIdle = !window->isVisible() || window->isMinimized();
+    if (nowIdle == idle)
+        return;
+    idle = nowIdle;
+    if (idle)
+        suspend();
+    else
+        resume();
+}
+
+void IdleScheduler::suspend() {
+    clockTimer->stop();
+    for (PollTask *task : std::as_const(pollTasks))
+        task->timer->stop();
+    for (const auto &hook : std::as_const(suspendHooks))
+        hook();
+}
+
+void IdleScheduler::resume() {
+    // 补一次时钟，再重新对齐到下一个整秒
+    clockTick();
+
+    for (PollTask *task : std::as_const(pollTasks)) {
+        const qint64 elapsed = task->sinceLastRun.elapsed();
+        if (elapsed >= task->intervalMs) {
+            // 藏着的时候已经到期了：现在补跑一次，从头计时
+            task->sinceLastRun.restart();
+            task->poll();
+            task->timer->start(task->intervalMs);
+        } else {
+            // 还没到期：只等剩下的那段时间，之后恢复原来的间隔
+            task->timer->start(static_cast<int>(task->intervalMs - elapsed));
+        }
+    }
+
+    for (const auto &hook : std::as_const(resumeHooks))
+        hook();
+}
+
+void IdleScheduler::scheduleClock() {
+    if (clockTasks.isEmpty())
+        return;
+    // 算出离下一个整秒还有多少毫秒，多等 1ms 免得醒在整秒前一点点
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    clockTimer->start(static_cast<int>(1000 - now % 1000) + 1);
+}
+
+void IdleScheduler::clockTick() {
+    for (const auto &tick : std::as_const(clockTasks))
+        tick();
+    if (!idle)
+        scheduleClock();
+}
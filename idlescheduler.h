@@ -0,0 +1,59 @@
+#ifndef IDLESCHEDULER_H
+#define IDLESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class QWidget;
+
+// --- 空闲调度器 ---
+// 盯着主窗口的显示 / 隐藏 (缩到托盘、最小化)。窗口看不见时：
+//   * 界面专用的定时任务 (时钟) 全部停掉，一次唤醒都没有；
+//   * 联网轮询推迟，只记下什么时候该跑；
+//   * 调用挂起钩子，丢掉各种控件缓存。
+// 窗口重新出现时每个任务补跑一次 (轮询只在已经到期时补)，然后恢复正常节奏。
+// 时钟任务对齐到整秒边界触发，不会因为定时器误差越走越偏。
+class IdleScheduler : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit IdleScheduler(QWidget *window, QObject *parent = nullptr);
+    ~IdleScheduler() override;
+
+    void addClockTask(const std::function<void()> &tick);                  // 每个整秒跑一次
+    void addPollTask(int intervalMs, const std::function<void()> &poll);   // 每 intervalMs 跑一次 (刚加入时不跑)
+    void addSuspendHook(const std::function<void()> &hook);                // 进入空闲时调用
+    void addResumeHook(const std::function<void()> &hook);                 // 恢复时调用 (在补跑之后)
+
+    bool isIdle() const { return idle; }
+
+  protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+  private:
+    struct PollTask {
+        QTimer *timer;
+        int intervalMs;
+        std::function<void()> poll;
+        QElapsedTimer sinceLastRun;
+    };
+
+    void updateIdle();
+    void suspend();
+    void resume();
+    void scheduleClock();
+    void clockTick();
+
+    QWidget *window;
+    bool idle = false;
+    QTimer *clockTimer;
+    QVector<std::function<void()>> clockTasks;
+    QVector<PollTask *> pollTasks;
+    QVector<std::function<void()>> suspendHooks;
+    QVector<std::function<void()>> resumeHooks;
+};
+
+#endif // IDLESCHEDULER_H
@@ -1,25 +1,50 @@
 #include "mainwindow.h"
+#include "singleinstance.h"
+#include "startupprofiler.h"
+#include "taskcli.h"
+#include "tracer.h"
 #include <QApplication>
+#include <QFont>
 
 int main(int argc, char *argv[]) {
+    // 第一个参数是 --cli 时走命令行模式：只起 QCoreApplication，不建窗口、不碰网络
+    if (argc > 1 && qstrcmp(argv[1], "--cli") == 0)
+        return runTaskCli(argc, argv);
+
+    // 启动计时从这里开始 (各阶段见 MainWindow 构造函数和 runDeferredStartup)
+    StartupProfiler::begin();
+
+    // 已经开着一个了：把参数转过去马上退出。这里只起一个轻量的 QCoreApplication，
+    // 不初始化图形界面，第二次启动整个过程只要几毫秒
+    {
+        QCoreApplication probe(argc, argv);
+        SingleInstance forwarder;
+        if (forwarder.forwardToRunning(probe.arguments().mid(1)))
+            return 0;
+    }
+
     QApplication app(argc, argv);
+    // ZTD_TRACE=1 (或设置里 trace=true) 时记录热点路径的耗时，退出时导出
+    Tracer::setupFromEnvironment();
 
-    // 设置全局样式 (依然放在这里)
     app.setWindowIcon(QIcon("logo.ico")); // 别忘了你的图标
-    app.setStyleSheet(R"(
-        QWidget { background-color: #f5f7fa; font-family: "Microsoft YaHei"; color: #333; }
-        QLineEdit { background-color: white; border: 2px solid #e0e6ed; border-radius: 8px; padding: 8px; }
-        QLineEdit:focus { border-color: #007bff; }
-        QPushButton { background-color: #007bff; color: white; border-radius: 8px; padding: 8px 16px; border: none; }
-        QPushButton:hover { background-color: #0056b3; }
-        QListWidget { background-color: white; border: 1px solid #e0e6ed; border-radius: 10px; padding: 10px; outline: none; }
-        QListWidget::item { padding: 10px; border-bottom: 1px solid #f0f0f0; }
-        QListWidget::item:selected { background-color: #e6f2ff; color: #007bff; }
-    )");
-
-    // 实例化主窗口对象
+    // 颜色和圆角都交给 ThemeEngine (调色板 + 自定义样式)，不再用全局样式表
+    app.setFont(QFont("Microsoft YaHei", 10));
+    StartupProfiler::mark("startup.app");
+
+    // 建窗口之前先占住名字：这之后再启动的都会连上这里，不会在我们读任务文件的时候另起一个。
+    // 刚才那一下到这里之间别人抢先占了，就照样转过去退出；
+    // 没监听成功 (比如套接字目录不可写) 也照常运行，只是没法转发
+    SingleInstance instance;
+    if (instance.listen() == SingleInstance::AlreadyRunning)
+        return instance.forwardToRunning(app.arguments().mid(1)) ? 0 : 1;
+
+    // 实例化主窗口对象。转过来的连接要等 app.exec() 才处理，那时信号已经接好了
     MainWindow w;
-    w.show();
+    QObject::connect(&instance, &SingleInstance::argumentsReceived, &w, &MainWindow::handleArguments);
+    w.handleArguments(app.arguments().mid(1)); // 自己的参数也走同一套，里面会把窗口显示出来
 
-    return app.exec();
+    const int ret = app.exec();
+    Tracer::exportAll();
+    return ret;
 }
\ No newline at end of file
@@ -1,104 +1,168 @@
 #include "mainwindow.h"
+#include "startupprofiler.h"
+#include "tracer.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QDir>
 #include <QFile>
+#include <QFormLayout>
 #include <QHBoxLayout>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QLabel>
 #include <QMessageBox>
+#include <QPixmapCache>
+#include <QSignalBlocker>
 #include <QVBoxLayout>
-
-// 改用 json 后缀
-const QString DATA_FILENAME = "todo_data.json";
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent) : QWidget(parent) {
+    // 启动分几段：构造函数里只做第一帧要看到的东西 (已经上好主题的控件 + 第一屏任务)，
+    // 托盘、天气、定时器等第一帧画出来之后再一段段补上，见 runDeferredStartup()
     this->setWindowTitle("Z-Td List");
+    // 主题引擎要在创建控件之前装好样式，免得控件先按默认样式 polish 一遍
+    theme = new ThemeEngine(this);
+    // 调色板也先换好：控件一创建就是对的颜色，不用显示出来之后再刷一遍
+    isDarkMode = QSettings("MySoft", "ToDoList").value("darkMode", false).toBool();
+    theme->apply(isDarkMode ? ThemeEngine::Dark : ThemeEngine::Light);
     this->resize(400, 600);
 
-    // 1. 初始化网络管理者
-    netManager = new QNetworkAccessManager(this);
-
-    // 2. 连接“请求完成”的信号
-    // 当网络请求回来时，自动执行这个 Lambda 函数
-    connect(netManager, &QNetworkAccessManager::finished, this, [=](QNetworkReply *reply) {
-        if (reply->error() == QNetworkReply::NoError) {
-            // A. 读取数据
-            QByteArray response = reply->readAll();
-
-            // B. 解析 JSON
-            QJsonDocument doc = QJsonDocument::fromJson(response);
-            QJsonObject obj = doc.object();
-            QJsonObject current = obj["current_weather"].toObject();
-
-            // C. 提取温度和天气代码
-            double temp = current["temperature"].toDouble();
-            int weatherCode = current["weathercode"].toInt();
-
-            // D. 更新 UI
-            QString emoji = getWeatherEmoji(weatherCode);
-            weatherLabel->setText(QString("%1 %2°C").arg(emoji).arg(temp));
-        } else {
-            weatherLabel->setText("❌ 网络错误");
-        }
-        reply->deleteLater(); // 释放内存
-    });
-
     setupUi();
-    setupTrayIcon(); // 设置系统托盘图标
-    fetchWeather();
-
-    // 4. (可选) 设置定时器，每 1 小时自动刷新一次
-    QTimer *weatherTimer = new QTimer(this);
-    connect(weatherTimer, &QTimer::timeout, this, &MainWindow::fetchWeather);
-    weatherTimer->start(3600 * 1000); // 3600秒 = 1小时
-
-    QTimer *timer = new QTimer(this);
+    StartupProfiler::mark("startup.ui");
 
-    connect(timer, &QTimer::timeout, this, [=]() {
-        // 获取当前系统时间
-        QDateTime current = QDateTime::currentDateTime();
-        // 格式化为：年-月-日 时:分:秒 星期几
-        QString timeStr = current.toString("yyyy-MM-dd HH:mm:ss dddd");
-        timeLabel->setText(timeStr);
-    });
-
-    timer->start(1000); // 启动定时器，间隔 1000ms (1秒)
+    // 这几样到后面的阶段才有
+    trayIcon = nullptr;
+    trayMenu = nullptr;
+    weather = nullptr;
+    idleScheduler = nullptr;
 
     QDateTime current = QDateTime::currentDateTime();
     timeLabel->setText(current.toString("yyyy-MM-dd HH:mm:ss dddd"));
 
     taskList->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(themeButton, &QPushButton::clicked, this, &MainWindow::toggleTheme);
-    connect(taskList, &QListWidget::customContextMenuRequested, this, &MainWindow::showContextMenu);
-    connect(taskList, &QListWidget::itemDoubleClicked, this, &MainWindow::editTask);
+    connect(taskList, &QListView::customContextMenuRequested, this, &MainWindow::showContextMenu);
+    connect(taskList, &QListView::doubleClicked, this,
+            [=](const QModelIndex &index) { editTask(filterModel->mapToSource(index)); });
     connect(addButton, &QPushButton::clicked, this, &MainWindow::addTask);
     connect(inputBox, &QLineEdit::returnPressed, this, &MainWindow::addTask);
-    connect(taskList, &QListWidget::itemChanged, this, &MainWindow::saveTasks);
     connect(clearButton, &QPushButton::clicked, [=]() {
-        for (int i = taskList->count() - 1; i >= 0; --i) {
-            QListWidgetItem *item = taskList->item(i);
-            if (item->checkState() == Qt::Checked) {
-                delete taskList->takeItem(i); // 移除并删除
+        // 连续的一段已完成任务一次删掉 (日志里也只记一条)
+        TraceSpan span("clearCompleted");
+        taskModel->removeDone();
+    });
+    connect(searchBox, &QLineEdit::textChanged, this, &MainWindow::applySearch);
+    connect(dateFilterBox, &QComboBox::activated, this, &MainWindow::onDateFilterActivated);
+
+    // 二进制快照映射一下就好；JSON 当场读第一片 (够画第一屏)，剩下的在事件循环里接着读
+    loadTasks();
+    StartupProfiler::mark("startup.tasks");
+    loadSettings(); // <--- 新增：加载软件设置 (复选框状态)
+
+    // 正常是第一次 paintEvent 之后开始后面的阶段；万一一直没画 (比如启动就藏在托盘)，过一会儿也照样开始
+    QTimer::singleShot(1000, this, &MainWindow::runDeferredStartup);
+}
+
+void MainWindow::paintEvent(QPaintEvent *event) {
+    QWidget::paintEvent(event);
+    if (deferredStartupQueued)
+        return;
+    StartupProfiler::mark("startup.firstPaint");
+    // 先让这一帧真正送上屏幕，下一轮事件循环再干别的
+    QTimer::singleShot(0, this, &MainWindow::runDeferredStartup);
+    deferredStartupQueued = true;
+}
+
+void MainWindow::runDeferredStartup() {
+    if (deferredStartupStarted)
+        return;
+    deferredStartupStarted = true;
+    deferredStartupQueued = true;
+
+    // 第二段：托盘
+    setupTrayIcon(); // 设置系统托盘图标
+    StartupProfiler::mark("startup.tray");
+
+    // 第三段 (再下一轮)：天气和定时任务，这里才第一次碰网络
+    QTimer::singleShot(0, this, [=]() {
+        // 天气：先显示上次保存的读数，网络回来后再刷新 (HTTP 缓存 + 失败退避都在 WeatherClient 里)
+        weather = new WeatherClient(this);
+        connect(weather, &WeatherClient::readingChanged, this, &MainWindow::showWeather);
+        if (weather->lastReading().isValid())
+            showWeather(weather->lastReading(), true); // 真连不上时请求失败会再标成离线
+        // 任务悬停时显示截止那天各地的预报 (只查内存里的预报表)
+        filterModel->setDayToolTipProvider([=](qint32 day) {
+            QStringList lines;
+            for (int i = 0; i < weather->locationCount(); ++i) {
+                DailyForecast f;
+                if (weather->forecast(i, day, &f))
+                    lines.append(QString("%1: %2 %3~%4°C")
+                                     .arg(weather->locationName(i), getWeatherEmoji(f.code))
+                                     .arg(f.tempMin)
+                                     .arg(f.tempMax));
             }
+            return lines.join('\n');
+        });
+        fetchWeather();
+
+        // 4. 定时任务交给空闲调度器：窗口缩到托盘时时钟停走、天气推迟，恢复时各补一次
+        idleScheduler = new IdleScheduler(this, this);
+        idleScheduler->addPollTask(3600 * 1000, [=]() { fetchWeather(); }); // 3600秒 = 1小时
+        idleScheduler->addClockTask([=]() {
+            // 获取当前系统时间
+            QDateTime current = QDateTime::currentDateTime();
+            // 格式化为：年-月-日 时:分:秒 星期几
+            QString timeStr = current.toString("yyyy-MM-dd HH:mm:ss dddd");
+            timeLabel->setText(timeStr);
+        });
+        idleScheduler->addSuspendHook([=]() {
+            // 看不见的时候没必要占着缓存和空闲的网络连接，失败重试也先停下
+            QPixmapCache::clear();
+            weather->clearConnectionCache();
+            weather->pauseRetries();
+            lists->releaseInactive(); // 别的清单先写盘放掉，下次切过去再读
+            taskDelegate->clearCache();
+        });
+        idleScheduler->addResumeHook([=]() { weather->resumeRetries(); });
+
+        // 同步：和天气共用一个 QNetworkAccessManager；轮询一样是窗口藏起来时推迟
+        QSettings settings("MySoft", "ToDoList");
+        const QString syncUrl = settings.value("syncUrl").toString();
+        if (!syncUrl.isEmpty()) {
+            syncEngine = new SyncEngine(weather->network(), QUrl(syncUrl), this);
+            syncEngine->setToken(settings.value("syncToken").toString());
+            connect(syncEngine, &SyncEngine::synced, this, [=](int, int received) {
+                if (received == 0)
+                    return;
+                if (filterModel->isFiltering())
+                    applySearch();
+                refreshListBox(); // 条数变了
+            });
+            idleScheduler->addPollTask(settings.value("syncIntervalMs", 60 * 1000).toInt(), [=]() { syncEngine->sync(); });
+            idleScheduler->addSuspendHook([=]() { syncEngine->pauseRetries(); });
+            idleScheduler->addResumeHook([=]() { syncEngine->resumeRetries(); });
         }
-        saveTasks(); // 保存更改
-    });
-    connect(searchBox, &QLineEdit::textChanged, [=](const QString &text) {
-        // 遍历每一行任务
-        for (int i = 0; i < taskList->count(); ++i) {
-            QListWidgetItem *item = taskList->item(i);
-            // 如果包含关键词 (不区分大小写)，就显示；否则隐藏
-            bool isMatch = item->text().contains(text, Qt::CaseInsensitive);
-            item->setHidden(!isMatch);
+
+        // 到期提醒：整个程序只有一个定时器，定在最近的那条上；窗口藏在托盘里时照样提醒
+        if (settings.value("remindersEnabled", true).toBool()) {
+            reminders = new ReminderScheduler(this);
+            reminders->setRemindAt(QTime::fromString(settings.value("reminderTime", "09:00").toString(), "HH:mm"));
+            connect(reminders, &ReminderScheduler::remindersDue, this, &MainWindow::showReminders);
         }
+        attachListServices();
+        StartupProfiler::mark("startup.weather");
+
+        deferredStartupDone = true;
+        maybeFinishStartup();
     });
-    connect(taskList->model(), &QAbstractItemModel::rowsMoved, this, &MainWindow::saveTasks);
+}
 
-    loadTasks();
-    loadSettings(); // <--- 新增：加载软件设置 (复选框状态)
+void MainWindow::maybeFinishStartup() {
+    // 后面几段都做完、当前清单也读完了才算启动结束
+    const TaskList *list = lists->list(lists->activeName());
+    if (deferredStartupDone && list && list->loaded && !StartupProfiler::isFinished())
+        StartupProfiler::finish();
 }
 
 MainWindow::~MainWindow() {
@@ -282,31 +346,54 @@ void MainWindow::setupUi() {
 
     // --- 1. 时间标签 ---
     timeLabel = new QLabel(this);
-    timeLabel->setStyleSheet("font-size: 16px; font-weight: bold; font-family: Consolas, Monospace; color: #555;");
+    // 字号沿用原来 CSS 里的像素值
+    QFont timeFont("Consolas");
+    timeFont.setStyleHint(QFont::Monospace);
+    timeFont.setPixelSize(16);
+    timeFont.setBold(true);
+    timeLabel->setFont(timeFont);
 
     weatherLabel = new QLabel(this);
     weatherLabel->setText("🌤️ 22°C 晴"); // 这里先写死，作为演示
-    weatherLabel->setStyleSheet("font-size: 16px;"
-                                "font-weight: bold;"
-                                "color: #555;"
-                                "margin-left: 15px;" // 关键：给左边加点间距，别和时间挤在一起
-                                "font-family: 'Microsoft YaHei';");
+    QFont weatherFont = weatherLabel->font();
+    weatherFont.setPixelSize(16);
+    weatherFont.setBold(true);
+    weatherLabel->setFont(weatherFont);
+    weatherLabel->setContentsMargins(15, 0, 0, 0); // 关键：给左边加点间距，别和时间挤在一起
 
     // --- 2. 主题切换按钮 ---
     themeButton = new QPushButton("🌙 切换主题", this);
-    themeButton->setStyleSheet("QPushButton { border: none; background: transparent; font-weight: bold; color: #666; }"
-                               "QPushButton:hover { color: #007ACC; }" // 悬停变蓝
-    );
+    themeButton->setFlat(true); // 透明背景，悬停时文字变蓝 (由 ThemeEngine 的样式负责)
+    QFont boldFont = themeButton->font();
+    boldFont.setBold(true);
+    themeButton->setFont(boldFont);
     themeButton->setCursor(Qt::PointingHandCursor);
 
     // --- 3. 搜索框 ---
     searchBox = new QLineEdit(this);
     searchBox->setPlaceholderText("🔍 搜索任务...");
-    searchBox->setStyleSheet("padding: 6px; border-radius: 15px; border: 1px solid #ddd; background: white;");
+
+    dateFilterBox = new QComboBox(this);
+    dateFilterBox->addItem("📅 全部日期", AllDates);
+    dateFilterBox->addItem("已过期", Overdue);
+    dateFilterBox->addItem("今天", DueToday);
+    dateFilterBox->addItem("本周", ThisWeek);
+    dateFilterBox->addItem("未来 30 天", Next30Days);
+    dateFilterBox->addItem("自定义范围...", CustomRange);
+    customFrom = QDate::currentDate();
+    customTo = customFrom.addDays(7);
+
+    // --- 清单切换 ---
+    listBox = new QComboBox(this);
+    listBox->setMinimumHeight(38);
 
     // --- 4. 标题 ---
     QLabel *titleLabel = new QLabel("今日待办事项", this);
-    titleLabel->setStyleSheet("font-size: 24px; font-weight: bold; margin: 15px 0; color: #333;");
+    QFont titleFont = titleLabel->font();
+    titleFont.setPixelSize(24);
+    titleFont.setBold(true);
+    titleLabel->setFont(titleFont);
+    titleLabel->setContentsMargins(0, 15, 0, 15);
     titleLabel->setAlignment(Qt::AlignCenter);
 
     // --- 5. 日期选择器 (大整容) ---
@@ -314,119 +401,55 @@ void MainWindow::setupUi() {
     dateEdit->setCalendarPopup(true);
     dateEdit->setDisplayFormat("yyyy-MM-dd");
     dateEdit->setMinimumHeight(38); // 稍微高一点
-    // 【CSS 魔法】
-    dateEdit->setStyleSheet("QDateEdit {"
-                            "   padding-left: 10px;"
-                            "   border: 1px solid #ccc;"
-                            "   border-radius: 6px;"
-                            "   color: #333;"
-                            "   background: white;"
-                            "}"
-                            // 右边的下拉按钮样式
-                            "QDateEdit::drop-down {"
-                            "   subcontrol-origin: padding;"
-                            "   subcontrol-position: top right;"
-                            "   width: 30px;"
-                            "   border-left: 1px solid #ccc;" /* 左边加一条线分割 */
-                            "   border-top-right-radius: 6px;"
-                            "   border-bottom-right-radius: 6px;"
-                            "   background-color: #f5f5f5;" /* 按钮背景稍微灰一点 */
-                            "}"
-                            "QDateEdit::drop-down:hover {"
-                            "   background-color: #e0e0e0;" /* 悬停变深 */
-                            "}"
-                            // 下箭头的样式 (虽然没放图片，但利用 CSS 让它看起来干净)
-                            "QDateEdit::down-arrow {"
-                            "   width: 10px; height: 10px;"
-                            // 这里如果有图片可以是 image: url(:/icon.png);
-                            // 没有图片时，Qt 默认会画一个小三角，我们通过上面的背景色让它显眼即可
-                            "}");
 
     // --- 6. 功能按钮 (加 Emoji + 动态效果) ---
     addButton = new QPushButton("➕ 添加任务", this); // 加上 Emoji
     addButton->setMinimumHeight(38);
     addButton->setCursor(Qt::PointingHandCursor);
-    addButton->setStyleSheet("QPushButton {"
-                             "   background-color: #007ACC;"
-                             "   color: white;"
-                             "   border-radius: 6px;"
-                             "   padding: 0 20px;"
-                             "   font-weight: bold;"
-                             "   font-size: 14px;"
-                             "}"
-                             "QPushButton:hover {"
-                             "   background-color: #0062a3;" /* 悬停变深蓝 */
-                             "}"
-                             "QPushButton:pressed {"
-                             "   background-color: #004472;" /* 按下更深 */
-                             "   padding-top: 2px;"          /* 只有按下时文字下移，产生按压感 */
-                             "}");
+    addButton->setProperty("accent", true); // 主按钮：强调色背景 + 白字
+    addButton->setFont(boldFont);
 
     clearButton = new QPushButton("🗑️ 清理完成", this); // 加上 Emoji
     clearButton->setMinimumHeight(38);
     clearButton->setCursor(Qt::PointingHandCursor);
-    clearButton->setStyleSheet("QPushButton {"
-                               "   background-color: #f0f0f0;"
-                               "   color: #333;"
-                               "   border: 1px solid #ccc;"
-                               "   border-radius: 6px;"
-                               "   padding: 0 15px;"
-                               "   font-weight: bold;"
-                               "}"
-                               "QPushButton:hover {"
-                               "   background-color: #e6e6e6;" /* 悬停变灰 */
-                               "   border-color: #bbb;"
-                               "}"
-                               "QPushButton:pressed {"
-                               "   background-color: #dcdcdc;"
-                               "   padding-top: 2px;"
-                               "}");
+    clearButton->setFont(boldFont);
 
     // --- 7. 输入框 (大、白、净) ---
     inputBox = new QLineEdit(this);
     inputBox->setPlaceholderText("✍️ 在此输入新的待办事项内容..."); // 加个笔的 Emoji
     inputBox->setMinimumHeight(50);
-    inputBox->setStyleSheet("QLineEdit {"
-                            "   font-size: 18px;"
-                            "   padding: 0 15px;"
-                            "   border: 2px solid #e0e6ed;" /* 默认边框浅蓝灰 */
-                            "   border-radius: 8px;"
-                            "   background-color: white;"
-                            "   color: #333;"
-                            "}"
-                            "QLineEdit:focus {"
-                            "   border: 2px solid #007ACC;" /* 聚焦时变亮蓝 */
-                            "}");
+    QFont inputFont = inputBox->font();
+    inputFont.setPixelSize(18);
+    inputBox->setFont(inputFont);
 
     // --- 8. 最小化选项 ---
     minimizeCheckBox = new QCheckBox("关闭时最小化到托盘", this);
     minimizeCheckBox->setChecked(true);
-    minimizeCheckBox->setStyleSheet("QCheckBox { font-size: 12px; color: #666; margin-bottom: 5px; }"
-                                    "QCheckBox::indicator { width: 16px; height: 16px; }" /* 放大一点勾选框 */
-    );
+    QFont smallFont = minimizeCheckBox->font();
+    smallFont.setPixelSize(12);
+    minimizeCheckBox->setFont(smallFont);
+    minimizeCheckBox->setForegroundRole(QPalette::PlaceholderText); // 灰一点的字
 
     // --- 9. 任务列表 ---
-    taskList = new QListWidget(this);
-    taskList->setStyleSheet("QListWidget {"
-                            "   font-size: 15px;"
-                            "   border: 1px solid #eee;"
-                            "   border-radius: 10px;"
-                            "   padding: 5px;"
-                            "   background-color: white;"
-                            "   outline: none;"
-                            "}"
-                            "QListWidget::item {"
-                            "   padding: 8px;"
-                            "   border-bottom: 1px solid #f9f9f9;"
-                            "}"
-                            "QListWidget::item:selected {"
-                            "   background-color: #e6f2ff;"
-                            "   color: #007ACC;"
-                            "   border-radius: 4px;"
-                            "}"
-                            "QListWidget::item:hover {"
-                            "   background-color: #f5f7fa;" /* 鼠标划过微微变色 */
-                            "}");
+    // QListView 只为可见的行创建绘制信息，百万条任务也不会卡
+    // 模型和索引属于当前清单，由 TaskListStore 在 loadTasks() 里给出来
+    taskModel = nullptr;
+    searchIndex = nullptr;
+    dateIndex = nullptr;
+    fuzzySearch = nullptr;
+    journal = nullptr;
+    // 视图挂在过滤代理上：搜索时一次换掉整个可见集合，切换清单时换掉源模型
+    filterModel = new TaskFilterModel(this);
+    taskList = new TaskListView(this); // 就是 QListView，多了绘制/布局的跟踪区间
+    taskList->setModel(filterModel);
+    taskList->setUniformItemSizes(true); // 每行一样高，滚动时不用逐行测量
+    // 行由自定义委托直接画，排版按行缓存，滚动时不再重新排字
+    taskDelegate = new TaskItemDelegate(theme, this);
+    taskDelegate->watchModel(filterModel);
+    taskList->setItemDelegate(taskDelegate);
+    QFont listFont = taskList->font();
+    listFont.setPixelSize(15);
+    taskList->setFont(listFont);
     taskList->setSelectionMode(QAbstractItemView::SingleSelection);
     taskList->setDragEnabled(true);
     taskList->setAcceptDrops(true);
@@ -447,8 +470,11 @@ void MainWindow::setupUi() {
     topLayout->addWidget(themeButton);  // 4. 主题按钮
     mainLayout->addLayout(topLayout);
 
-    // Search
-    mainLayout->addWidget(searchBox);
+    // Search (关键词 + 日期筛选)
+    QHBoxLayout *searchLayout = new QHBoxLayout();
+    searchLayout->addWidget(searchBox, 1);
+    searchLayout->addWidget(dateFilterBox);
+    mainLayout->addLayout(searchLayout);
 
     // Title
     mainLayout->addWidget(titleLabel);
@@ -456,6 +482,7 @@ void MainWindow::setupUi() {
     // Control Bar (日历 + 添加 + 清理)
     QHBoxLayout *controlLayout = new QHBoxLayout();
     controlLayout->setSpacing(10); // 按钮之间的间距
+    controlLayout->addWidget(listBox);
     controlLayout->addWidget(dateEdit);
     controlLayout->addWidget(addButton);
     controlLayout->addStretch();
@@ -479,89 +506,325 @@ void MainWindow::addTask() {
     if (text.isEmpty())
         return;
 
-    QString displayText = QString("[%1] %2").arg(date).arg(text);
-
-    QListWidgetItem *item = new QListWidgetItem(displayText);
-    item->setFlags(item->flags() | Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
-    item->setCheckState(Qt::Unchecked);
+    TaskRecord task;
+    task.title = text; // 存纯标题
+    task.setDate(date); // 存日期 (内部是儒略日)
+    task.done = false;
 
-    item->setData(Qt::UserRole, text);     // 存纯标题
-    item->setData(Qt::UserRole + 1, date); // 存日期
-
-    taskList->addItem(item);
+    taskModel->appendTask(task);
+    if (filterModel->isFiltering())
+        applySearch(); // 新任务符合搜索条件的话也要显示出来
 
     inputBox->clear();
     // dateEdit->setDate(QDate::currentDate()); // 可选：重置日期
-    saveTasks();
 }
 
-void MainWindow::deleteTask(QListWidgetItem *item) {
+void MainWindow::deleteTask(const QModelIndex &index) {
+    // 弹框期间列表可能变化，用持久索引记住是哪一行
+    QPersistentModelIndex target(index);
     int ret = QMessageBox::question(this, "确认", "确定要删除这条任务吗？", QMessageBox::Yes | QMessageBox::No);
-    if (ret == QMessageBox::Yes) {
-        delete item;
-        saveTasks();
+    if (ret == QMessageBox::Yes && target.isValid()) {
+        taskModel->removeRows(target.row(), 1);
     }
 }
 
-// --- 核心升级：保存为 JSON ---
-void MainWindow::saveTasks() {
-    QString path = QCoreApplication::applicationDirPath() + "/" + DATA_FILENAME;
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly))
+// --- 搜索：关键词走模糊匹配 (按相关度排) 或倒排索引，日期查有序索引，两边的结果求交集后一次性交给过滤代理 ---
+void MainWindow::applySearch() {
+    TraceSpan span("applySearch");
+    const QString text = searchBox->text();
+    qint32 fromDay = 0, toDay = 0;
+    const bool byDate = dateFilterRange(fromDay, toDay);
+    if (text.isEmpty() && !byDate) {
+        filterModel->clearFilter();
         return;
-    QJsonArray jsonArray;
+    }
+
+    const bool ranked = useFuzzySearch && !text.isEmpty();
+    QVector<quint32> ids; // 模糊匹配的按相关度排，两个索引返回的都是按编号升序的
+    if (ranked) {
+        ids = fuzzySearch->search(text);
+        // 模糊匹配只看标题；带数字的关键词可能是在搜日期，倒排索引里按日期命中的接在后面
+        if (std::any_of(text.begin(), text.end(), [](QChar ch) { return ch.isDigit(); })) {
+            QVector<quint32> seen = ids;
+            std::sort(seen.begin(), seen.end());
+            for (quint32 id : searchIndex->search(text)) {
+                if (!std::binary_search(seen.begin(), seen.end(), id))
+                    ids.append(id);
+            }
+        }
+    } else if (!text.isEmpty()) {
+        ids = searchIndex->search(text);
+    }
+
+    if (byDate) {
+        const QVector<quint32> byDay = dateIndex->query(fromDay, toDay);
+        if (text.isEmpty()) {
+            ids = byDay;
+        } else if (ranked) {
+            // 保持相关度的顺序，只剔掉日期不在范围里的
+            ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                     [&](quint32 id) { return !std::binary_search(byDay.begin(), byDay.end(), id); }),
+                      ids.end());
+        } else {
+            QVector<quint32> byText;
+            byText.swap(ids);
+            std::set_intersection(byText.begin(), byText.end(), byDay.begin(), byDay.end(), std::back_inserter(ids));
+        }
+    }
 
-    for (int i = 0; i < taskList->count(); ++i) {
-        QListWidgetItem *item = taskList->item(i);
-        QJsonObject taskObj;
+    // 已经完成的任务不算过期
+    if (dateFilterBox->currentData().toInt() == Overdue) {
+        ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                 [this](quint32 id) { return taskModel->isDone(taskModel->rowForId(id)); }),
+                  ids.end());
+    }
+    filterModel->setFilter(ids, ranked ? TaskFilterModel::GivenOrder : TaskFilterModel::ListOrder);
+}
 
-        // 提取已有信息
-        taskObj["title"] = item->data(Qt::UserRole).toString();    // 注意：这里我们改用 UserRole 存纯文本
-        taskObj["date"] = item->data(Qt::UserRole + 1).toString(); // 用 UserRole+1 存日期
-        taskObj["done"] = (item->checkState() == Qt::Checked);
+bool MainWindow::dateFilterRange(qint32 &fromDay, qint32 &toDay) const {
+    const QDate today = QDate::currentDate();
+    const qint32 t = static_cast<qint32>(today.toJulianDay());
+    switch (dateFilterBox->currentData().toInt()) {
+    case Overdue:
+        fromDay = 1;
+        toDay = t - 1;
+        return true;
+    case DueToday:
+        fromDay = toDay = t;
+        return true;
+    case ThisWeek: // 周一到周日
+        fromDay = t - (today.dayOfWeek() - 1);
+        toDay = fromDay + 6;
+        return true;
+    case Next30Days:
+        fromDay = t;
+        toDay = t + 30;
+        return true;
+    case CustomRange:
+        fromDay = static_cast<qint32>(customFrom.toJulianDay());
+        toDay = static_cast<qint32>(customTo.toJulianDay());
+        return true;
+    default:
+        return false;
+    }
+}
 
-        jsonArray.append(taskObj);
+void MainWindow::onDateFilterActivated(int index) {
+    if (dateFilterBox->itemData(index).toInt() == CustomRange) {
+        // 弹个小对话框选起止日期
+        QDialog dialog(this);
+        dialog.setWindowTitle("自定义日期范围");
+        QDateEdit *fromEdit = new QDateEdit(customFrom, &dialog);
+        QDateEdit *toEdit = new QDateEdit(customTo, &dialog);
+        for (QDateEdit *edit : {fromEdit, toEdit}) {
+            edit->setCalendarPopup(true);
+            edit->setDisplayFormat("yyyy-MM-dd");
+        }
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+        connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+        QFormLayout *form = new QFormLayout(&dialog);
+        form->addRow("从", fromEdit);
+        form->addRow("到", toEdit);
+        form->addRow(buttons);
+
+        if (dialog.exec() != QDialog::Accepted) {
+            dateFilterBox->setCurrentIndex(lastDateFilter);
+            return;
+        }
+        customFrom = std::min(fromEdit->date(), toEdit->date());
+        customTo = std::max(fromEdit->date(), toEdit->date());
     }
-    QJsonDocument doc(jsonArray);
-    file.write(doc.toJson());
-    file.close();
+    lastDateFilter = index;
+    applySearch();
 }
 
-// --- 核心升级：从 JSON 加载 ---
+// --- 核心升级：读快照 + 重放日志 (只读当前清单，别的清单切过去时才读) ---
 void MainWindow::loadTasks() {
-    QString path = QCoreApplication::applicationDirPath() + "/" + DATA_FILENAME;
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly))
-        return;
+    TraceSpan span("loadTasks");
+    QSettings settings("MySoft", "ToDoList");
+    // 合并写入的时间窗口 (毫秒)，可以在设置里调
+    int saveDelayMs = settings.value("saveDelayMs", 300).toInt();
+    // 同时留在内存里的清单个数，多出来的按最久没看的先释放
+    int maxLoadedLists = settings.value("maxLoadedLists", 3).toInt();
+    lists = new TaskListStore(saveDelayMs, maxLoadedLists, this);
+
+    // JSON 是分几轮事件循环流式读进来的，读完之前先不让添加/清理
+    connect(lists, &TaskListStore::listLoaded, this, [=](const QString &name) {
+        if (name == lists->activeName()) {
+            setTasksEditable(true);
+            attachListServices();
+            if (!StartupProfiler::isFinished()) {
+                StartupProfiler::mark("startup.tasksLoaded");
+                maybeFinishStartup();
+            }
+        }
+        // 加载期间从命令行送来的任务
+        const QList<TaskRecord> queued = pendingTasks.values(name);
+        if (!queued.isEmpty()) {
+            pendingTasks.remove(name);
+            // values() 是后进先出的，倒回来保持送来的顺序
+            lists->list(name)->model->appendTasks(QVector<TaskRecord>(queued.rbegin(), queued.rend()));
+            if (name == lists->activeName() && filterModel->isFiltering())
+                applySearch();
+        }
+        refreshListBox(); // 条数变了
+    });
+    connect(listBox, &QComboBox::activated, this, &MainWindow::onListActivated);
+    // 任务文件被别的程序改了：改动已经按编号合并进模型 (滚动位置和选中项不动)，这里只刷新附带的显示
+    connect(lists, &TaskListStore::listChangedOnDisk, this, [=](const QString &name, int changedRows) {
+        if (changedRows == 0)
+            return;
+        if (name == lists->activeName() && filterModel->isFiltering())
+            applySearch();
+        refreshListBox();
+    });
 
-    QByteArray data = file.readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    QJsonArray jsonArray = doc.array();
+    // 换了格式时会先读另一种格式的文件，之后自动按新格式重写
+    switchList(lists->activeName());
+}
 
-    for (const QJsonValue &value : jsonArray) {
-        QJsonObject taskObj = value.toObject();
+void MainWindow::switchList(const QString &name) {
+    TraceSpan span("switchList");
+    if (!lists->list(name))
+        return;
+    // 先从旧清单上卸下来：activate 可能把它写盘释放掉
+    if (syncEngine)
+        syncEngine->detach();
+    if (reminders)
+        reminders->attach(nullptr);
+    // 代理和索引指针也先放开：只留一个清单在内存里时 activate 会把刚才这个释放掉
+    filterModel->setSourceModel(nullptr);
+    taskModel = nullptr;
+    journal = nullptr;
+    searchIndex = nullptr;
+    dateIndex = nullptr;
+    fuzzySearch = nullptr;
+    TaskList *list = lists->activate(name);
+    if (!list)
+        return;
+    taskModel = list->model;
+    journal = list->journal;
+    searchIndex = list->searchIndex;
+    dateIndex = list->dateIndex;
+    fuzzySearch = list->fuzzySearch;
+    // 换源模型会清掉过滤，按当前的搜索条件重新筛一遍
+    filterModel->setSourceModel(taskModel);
+    setTasksEditable(list->loaded);
+    applySearch();
+    refreshListBox();
+    attachListServices();
+}
 
-        QString title = taskObj["title"].toString();
-        QString date = taskObj["date"].toString();
-        bool isDone = taskObj["done"].toBool();
+void MainWindow::attachListServices() {
+    const TaskList *list = lists->list(lists->activeName());
+    if (!list || !list->loaded)
+        return;
+    if (reminders)
+        reminders->attach(list->model);
+    if (syncEngine && !syncEngine->isAttached())
+        syncEngine->attach(list->model, list->name, SyncEngine::statePathFor(lists->snapshotPath(list->name)));
+}
 
-        // 如果是旧数据没有 title 字段（兼容性处理）
-        if (title.isEmpty())
-            title = "旧任务";
+void MainWindow::showReminders(const QVector<quint32> &ids) {
+    if (!trayIcon)
+        return;
+    // 提醒只挂在当前清单上，编号都是 taskModel 里的
+    QStringList titles;
+    for (const quint32 id : ids) {
+        const int row = taskModel->rowForId(id);
+        if (row >= 0)
+            titles.append("• " + taskModel->title(row));
+    }
+    if (titles.isEmpty())
+        return;
+    // 一次到期很多条时只列前几条，免得通知被系统截断
+    const int shown = 5;
+    QString body = QStringList(titles.mid(0, shown)).join('\n');
+    if (titles.size() > shown)
+        body += QString("\n…还有 %1 条").arg(titles.size() - shown);
+    const QString title = titles.size() == 1 ? "任务今天到期" : QString("%1 条任务今天到期").arg(titles.size());
+    trayIcon->showMessage(title, body, QSystemTrayIcon::Information);
+}
 
-        QString displayText = QString("[%1] %2").arg(date).arg(title);
-        QListWidgetItem *item = new QListWidgetItem(displayText);
+void MainWindow::refreshListBox() {
+    QSignalBlocker blocker(listBox);
+    listBox->clear();
+    for (const QString &name : lists->names()) {
+        const TaskList *list = lists->list(name);
+        // 加载着的清单显示实时条数，其余显示目录里记的
+        const qint64 count = list->loaded ? list->model->rowCount() : list->count;
+        listBox->addItem(QString("📋 %1 (%2)").arg(name).arg(count), name);
+    }
+    listBox->addItem("➕ 新建清单...");
+    listBox->setCurrentIndex(lists->names().indexOf(lists->activeName()));
+}
 
-        item->setFlags(item->flags() | Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
-        item->setCheckState(isDone ? Qt::Checked : Qt::Unchecked);
+void MainWindow::onListActivated(int index) {
+    const QString name = listBox->itemData(index).toString();
+    if (!name.isEmpty()) {
+        if (name != lists->activeName())
+            switchList(name);
+        return;
+    }
 
-        // 恢复隐藏数据
-        item->setData(Qt::UserRole, title);
-        item->setData(Qt::UserRole + 1, date);
+    // 最后一项：新建清单
+    bool ok = false;
+    const QString newName = QInputDialog::getText(this, "新建清单", "清单名称:", QLineEdit::Normal, QString(), &ok).trimmed();
+    if (ok && lists->createList(newName)) {
+        switchList(newName);
+        return;
+    }
+    if (ok && !newName.isEmpty())
+        QMessageBox::warning(this, "新建清单", "已经有叫这个名字的清单了。");
+    refreshListBox(); // 退回到当前清单
+}
 
-        taskList->addItem(item);
+void MainWindow::handleArguments(const QStringList &arguments) {
+    QCommandLineParser parser;
+    QCommandLineOption addOption("add", "添加一条任务", "标题");
+    QCommandLineOption dateOption("date", "--add 的截止日期 (默认今天)", "yyyy-MM-dd");
+    QCommandLineOption listOption("list", "切换到这个清单", "名称");
+    parser.addOptions({addOption, dateOption, listOption});
+    // parse 要求第一个是程序名；不认识的参数忽略，照样把窗口提出来
+    parser.parse(QStringList("Z-Td") + arguments);
+
+    const QString listName = parser.value(listOption);
+    if (!listName.isEmpty() && listName != lists->activeName() && lists->list(listName))
+        switchList(listName);
+
+    const QString date =
+        parser.isSet(dateOption) ? parser.value(dateOption) : QDate::currentDate().toString("yyyy-MM-dd");
+    QVector<TaskRecord> added;
+    for (const QString &title : parser.values(addOption)) {
+        if (title.trimmed().isEmpty())
+            continue;
+        TaskRecord task;
+        task.title = title.trimmed();
+        task.setDate(date);
+        added.append(task);
+    }
+    if (!added.isEmpty()) {
+        const TaskList *list = lists->list(lists->activeName());
+        if (list->loaded) {
+            taskModel->appendTasks(added);
+            if (filterModel->isFiltering())
+                applySearch();
+        } else {
+            for (const TaskRecord &task : added)
+                pendingTasks.insert(list->name, task);
+        }
     }
-    file.close();
+
+    showNormal();
+    raise();
+    activateWindow(); // Windows 上别的进程抢不了前台，最多任务栏闪一下
+}
+
+void MainWindow::setTasksEditable(bool on) {
+    inputBox->setEnabled(on);
+    addButton->setEnabled(on);
+    clearButton->setEnabled(on);
 }
 
 // --- 新增：初始化托盘图标和菜单 ---
@@ -573,11 +836,23 @@ void MainWindow::setupTrayIcon() {
     QAction *restoreAction = trayMenu->addAction("显示主界面");
     connect(restoreAction, &QAction::triggered, this, &MainWindow::showNormal);
 
+    // 打开了性能跟踪时，随时可以导出一份 (退出时也会自动导出)
+    if (Tracer::isEnabled()) {
+        QAction *traceAction = trayMenu->addAction("导出性能跟踪");
+        connect(traceAction, &QAction::triggered, this, [=]() {
+            if (Tracer::exportAll())
+                trayIcon->showMessage("Z-Td", "已导出到 " + Tracer::outputPath());
+        });
+    }
+
     // 添加 "退出" 动作
     QAction *quitAction = trayMenu->addAction("退出");
     connect(quitAction, &QAction::triggered, [=]() {
-        saveSettings(); // 保存复选框状态
-        qApp->quit();   // 退出程序
+        saveSettings();    // 保存复选框状态
+        if (syncEngine)
+            syncEngine->detach(); // 没发出去的改动记进同步状态，下次启动接着发
+        lists->flushAll(); // 等工作线程把还没写的任务写完
+        qApp->quit();      // 退出程序
     });
 
     // 2. 创建托盘图标
@@ -603,13 +878,16 @@ void MainWindow::setupTrayIcon() {
 }
 
 void MainWindow::closeEvent(QCloseEvent *event) {
-    // 先判断是否要最小化
-    if (minimizeCheckBox->isChecked()) {
+    // 先判断是否要最小化 (托盘还没建好时缩下去就找不回来了，直接退出)
+    if (minimizeCheckBox->isChecked() && trayIcon) {
         this->hide();
         event->ignore();
     } else {
         // 如果要退出了，赶紧保存设置！
         saveSettings(); // <--- 新增
+        if (syncEngine)
+            syncEngine->detach();
+        lists->flushAll();
         event->accept();
     }
 }
@@ -617,9 +895,10 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 // --- 新增：显示右键菜单 ---
 void MainWindow::showContextMenu(const QPoint &pos) {
     // 1. 获取鼠标点击位置的任务项
-    QListWidgetItem *item = taskList->itemAt(pos);
-    if (!item)
-        return; // 如果点在空白处，不显示菜单
+    // 视图里的行号是搜索结果里的，换算回任务仓库的行
+    QPersistentModelIndex index = filterModel->mapToSource(taskList->indexAt(pos));
+    if (!index.isValid() || taskModel->isReadOnly())
+        return; // 如果点在空白处 (或者还在加载)，不显示菜单
 
     // 2. 创建菜单
     QMenu menu(this);
@@ -629,11 +908,11 @@ void MainWindow::showContextMenu(const QPoint &pos) {
     // 3. 连接菜单动作
     // 使用 Lambda 表达式来处理点击
     connect(editAction, &QAction::triggered, [=]() {
-        editTask(item); // 调用编辑函数
+        editTask(index); // 调用编辑函数
     });
 
     connect(deleteAction, &QAction::triggered, [=]() {
-        deleteTask(item); // 调用删除函数
+        deleteTask(index); // 调用删除函数
     });
 
     // 4. 在鼠标位置弹出菜单
@@ -641,16 +920,21 @@ void MainWindow::showContextMenu(const QPoint &pos) {
 }
 
 // --- 新增：编辑任务逻辑 ---
-void MainWindow::editTask(QListWidgetItem *item) {
+void MainWindow::editTask(const QModelIndex &index) {
+    if (!index.isValid() || taskModel->isReadOnly())
+        return;
+    QPersistentModelIndex target(index);
+
     bool ok;
-    // 弹出输入框，默认填入旧文字
-    QString oldText = item->text();
+    // 弹出输入框，默认填入旧标题
+    QString oldText = taskModel->title(index.row());
     QString newText = QInputDialog::getText(this, "修改任务", "请输入新的内容:", QLineEdit::Normal, oldText, &ok);
 
     // 如果用户点了确定(ok) 且 内容不为空
-    if (ok && !newText.trimmed().isEmpty()) {
-        item->setText(newText.trimmed()); // 更新界面
-        saveTasks();                      // 保存到文件
+    if (ok && !newText.trimmed().isEmpty() && target.isValid()) {
+        taskModel->setTitle(target.row(), newText.trimmed()); // 更新模型 (journal 会记下这次修改)
+        if (filterModel->isFiltering())
+            applySearch(); // 改过的标题可能不再符合搜索条件
     }
 }
 
@@ -673,8 +957,8 @@ void MainWindow::loadSettings() {
     QSettings settings("MySoft", "ToDoList");
     bool isMinimize = settings.value("minimizeToTray", true).toBool();
     minimizeCheckBox->setChecked(isMinimize);
-    isDarkMode = settings.value("darkMode", false).toBool();
-    updateThemeStyle();
+    useFuzzySearch = settings.value("fuzzySearch", true).toBool();
+    // darkMode 在构造函数一开头就读过、主题也已经装上了
     if (settings.contains("geometry")) {
         restoreGeometry(settings.value("geometry").toByteArray());
     }
@@ -692,49 +976,29 @@ void MainWindow::toggleTheme() {
 }
 
 void MainWindow::updateThemeStyle() {
-    QString style;
-    if (isDarkMode) {
-        // --- 黑夜模式样式 ---
-        style = R"(
-            QWidget { background-color: #2b2b2b; color: #e0e0e0; font-family: "Microsoft YaHei"; }
-            QLineEdit { background-color: #3c3f41; border: 1px solid #555; border-radius: 8px; padding: 8px; color: white; }
-            QListWidget { background-color: #3c3f41; border: 1px solid #555; border-radius: 10px; padding: 10px; }
-            QListWidget::item { border-bottom: 1px solid #555; }
-            QListWidget::item:selected { background-color: #4b6eaf; }
-            QPushButton { background-color: #365880; color: white; border-radius: 6px; padding: 6px; }
-            QPushButton:hover { background-color: #4b6eaf; }
-        )";
-        timeLabel->setStyleSheet("color: #e0e0e0; font-size: 16px; font-weight: bold; font-family: Consolas;");
-        weatherLabel->setStyleSheet(
-            "color: #e0e0e0; font-size: 16px; font-weight: bold; margin-left: 15px; font-family: 'Microsoft YaHei';");
-    } else {
-        // --- 亮色模式样式 (原来的) ---
-        style = R"(
-            QWidget { background-color: #f5f7fa; color: #333; font-family: "Microsoft YaHei"; }
-            QLineEdit { background-color: white; border: 1px solid #ccc; border-radius: 8px; padding: 8px; color: #333; }
-            QListWidget { background-color: white; border: 1px solid #ccc; border-radius: 10px; padding: 10px; }
-            QListWidget::item { border-bottom: 1px solid #eee; }
-            QListWidget::item:selected { background-color: #e6f2ff; color: #007bff; }
-            QPushButton { background-color: #007ACC; color: white; border-radius: 6px; padding: 6px; }
-            QPushButton:hover { background-color: #0056b3; }
-        )";
-        timeLabel->setStyleSheet("color: #555; font-size: 16px; font-weight: bold; font-family: Consolas;");
-        weatherLabel->setStyleSheet(
-            "color: #555; font-size: 16px; font-weight: bold; margin-left: 15px; font-family: 'Microsoft YaHei';");
-    }
-    qApp->setStyleSheet(style);
+    TraceSpan span("updateThemeStyle");
+    // 两套调色板启动时就建好了，这里只是换一下，不用重新解析样式表
+    theme->apply(isDarkMode ? ThemeEngine::Dark : ThemeEngine::Light);
+    taskDelegate->clearCache(); // 缓存的排版跟着主题一起作废
 }
 
 void MainWindow::fetchWeather() {
-    // Open-Meteo API URL
-    // latitude=纬度, longitude=经度
-    QString url = "https://api.open-meteo.com/v1/forecast?"
-                  "latitude=23.02&longitude=113.23" // <--- 这里修改你的坐标
-                  "&current_weather=true";
-
-    // 发送 GET 请求
-    netManager->get(QNetworkRequest(QUrl(url)));
+    // 地址和地点在设置里 (weatherBaseUrl / weatherLocations)，所有地点一次请求
+    weather->fetch();
+}
+
+void MainWindow::showWeather(const WeatherReading &reading, bool fresh) {
+    if (!reading.isValid()) {
+        weatherLabel->setText("❌ 网络错误");
+        return;
+    }
+    QString text = QString("%1 %2°C").arg(getWeatherEmoji(reading.code)).arg(reading.temperature);
+    if (!fresh)
+        text += " (离线)"; // 网络不通，显示的是上次的数据
+    weatherLabel->setText(text);
+    weatherLabel->setToolTip("更新于 " + reading.fetchedAt.toString("yyyy-MM-dd HH:mm"));
 }
+
 QString MainWindow::getWeatherEmoji(int code) {
     // 根据 WMO Weather Codes 转换
     // 0: 晴天, 1-3: 多云, 45-48: 雾, 51-67: 雨, 71-77: 雪, 95-99: 雷雨
@@ -4,12 +4,15 @@
 #include <QAction>
 #include <QCheckBox>
 #include <QCloseEvent>
+#include <QComboBox>
 #include <QDateEdit>
 #include <QDateTime>
+#include <QFont>
+#include <QMultiHash>
 #include <QInputDialog>
 #include <QLabel>
 #include <QLineEdit>
-#include <QListWidget>
+#include <QListView>
 #include <QMenu>
 #include <QPushButton>
 #include <QSettings>
@@ -17,24 +20,52 @@
 #include <QTimer>
 #include <QWidget>
 
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include "idlescheduler.h"
+#include "reminderscheduler.h"
+#include "taskdateindex.h"
+#include "taskfiltermodel.h"
+#include "taskfuzzysearch.h"
+#include "taskitemdelegate.h"
+#include "taskjournal.h"
+#include "tasklistview.h"
+#include "taskliststore.h"
+#include "taskmodel.h"
+#include "tasksearchindex.h"
+#include "syncengine.h"
+#include "themeengine.h"
+#include "weatherclient.h"
 class MainWindow : public QWidget {
     Q_OBJECT
 
   public:
+    // 日期筛选下拉框的各项
+    enum DateFilter { AllDates, Overdue, DueToday, ThisWeek, Next30Days, CustomRange };
+
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 处理启动参数 (自己的，或者第二次启动转过来的)：--add 标题 [--date 日期] [--list 清单]，最后把窗口提到前面
+    void handleArguments(const QStringList &arguments);
+
   protected:
     void closeEvent(QCloseEvent *event) override;
+    void paintEvent(QPaintEvent *event) override; // 第一帧画完后开始启动的后几段
 
   private:
     QLabel *timeLabel;
     QDateEdit *dateEdit;
-    QListWidget *taskList;
+    TaskListView *taskList;
+    TaskModel *taskModel; // 任务仓库 (model/view)
+    TaskFilterModel *filterModel;  // 视图实际看到的模型 (搜索时只含命中的行)
+    TaskItemDelegate *taskDelegate; // 画任务行 (排版按行缓存)
+    TaskSearchIndex *searchIndex;  // 搜索框用的倒排索引
+    TaskDateIndex *dateIndex;      // 按截止日期筛选用的有序索引
+    TaskFuzzySearch *fuzzySearch;  // 搜索框的模糊匹配 (按相关度排)
+    TaskJournal *journal; // 追加式日志持久化
+    // taskModel / searchIndex / dateIndex / fuzzySearch / journal 都属于当前清单，切换清单时整体换掉
+    TaskListStore *lists;  // 多清单：每个清单一个分片，按需加载
+    QComboBox *listBox;    // 切换清单 (最后一项是"新建清单...")
+    QMultiHash<QString, TaskRecord> pendingTasks; // --add 进来时清单还在加载：按清单名攒着，加载完再加
     QLineEdit *inputBox;
     QPushButton *addButton;
     QPushButton *clearButton;
@@ -42,26 +73,49 @@ class MainWindow : public QWidget {
     QSystemTrayIcon *trayIcon;
     QMenu *trayMenu;
     QLineEdit *searchBox;
+    QComboBox *dateFilterBox; // 按截止日期筛选 (可以和关键词一起用)
+    QDate customFrom;         // "自定义范围" 的起止日期
+    QDate customTo;
+    int lastDateFilter = 0; // 自定义范围对话框被取消时退回这一项
     QPushButton *themeButton; // 切换主题的按钮
     QLabel *weatherLabel;
-    QNetworkAccessManager *netManager; // 网络管理器
+    WeatherClient *weather;            // 天气 (带磁盘缓存和离线兜底)
     bool isDarkMode = false;           // 记录当前是不是黑夜模式
+    bool useFuzzySearch = true;        // 搜索框按相关度模糊匹配 (设置 fuzzySearch=false 退回精确子串)
+    ThemeEngine *theme;                // 预先建好的亮色/暗色主题
+    IdleScheduler *idleScheduler;      // 时钟、天气轮询 (窗口隐藏时暂停)
+    SyncEngine *syncEngine = nullptr;  // 增量同步 (设置里填了 syncUrl 才有)，只挂在当前清单上
+    ReminderScheduler *reminders = nullptr; // 到期提醒 (托盘通知)，也只管当前清单
+    bool deferredStartupQueued = false;  // 第一帧之后的启动阶段已经排上了
+    bool deferredStartupStarted = false;
+    bool deferredStartupDone = false;
 
     void toggleTheme();      // 切换主题的函数
     void updateThemeStyle(); // 刷新样式的函数
 
     void showContextMenu(const QPoint &pos); // 显示右键菜单
-    void editTask(QListWidgetItem *item);    // 编辑任务
+    void editTask(const QModelIndex &index); // 编辑任务 (index 是 taskModel 里的)
     void setupUi();
     void setupTrayIcon(); // 专门用来初始化托盘的函数
+    void runDeferredStartup(); // 启动的后几段：托盘 → 天气 + 定时任务
+    void maybeFinishStartup();
     void loadTasks();
-    void saveTasks();
+    void switchList(const QString &name);
+    void attachListServices(); // 同步和提醒挂到当前清单 (还没加载完就先不挂)
+    void showReminders(const QVector<quint32> &ids);
+    void refreshListBox();
+    void onListActivated(int index);
+    void setTasksEditable(bool on); // 清单还在加载时不让添加/清理
     void addTask();
-    void deleteTask(QListWidgetItem *item);
+    void deleteTask(const QModelIndex &index);
+    void applySearch(); // 按搜索框内容 + 日期筛选刷新可见的任务
+    void onDateFilterActivated(int index);
+    bool dateFilterRange(qint32 &fromDay, qint32 &toDay) const; // 当前日期筛选对应的儒略日范围
     void loadSettings(); // 启动时读取
     void saveSettings(); // 关闭时保存
 
     void fetchWeather();
+    void showWeather(const WeatherReading &reading, bool fresh);
     QString getWeatherEmoji(int code); // 根据天气代码返回对应的表情符号
 };
 
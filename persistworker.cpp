@@ -0,0 +1,78 @@
+#include "persistworker.h"
+#include "taskjournal.h"
+#include "tracer.h"
+#include <QDebug>
+#include <QFileInfo>
+
+PersistWorker::PersistWorker(const QString &snapshotPath, const QString &altPath, const QString &logPath,
+                             int coalesceMs)
+    : snapshotPath(snapshotPath), altPath(altPath), logPath(logPath) {
+    // 定时器是 worker 的子对象，moveToThread 时会一起搬到工作线程
+    coalesceTimer = new QTimer(this);
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(coalesceMs);
+    connect(coalesceTimer, &QTimer::timeout, this, &PersistWorker::writePending);
+}
+
+void PersistWorker::appendLines(const QByteArray &lines) {
+    pendingLines += lines;
+    if (!coalesceTimer->isActive())
+        coalesceTimer->start();
+}
+
+void PersistWorker::requestSnapshot(const TaskTable &tasks, quint64 generation) {
+    // 快照已经包含了之前所有的操作，没写出去的日志行先放一边，快照写成功就丢掉
+    supersededLines += pendingLines;
+    pendingLines.clear();
+    snapshotTasks = tasks;
+    snapshotGeneration = generation;
+    snapshotPending = true;
+    if (!coalesceTimer->isActive())
+        coalesceTimer->start();
+}
+
+void PersistWorker::flush() {
+    coalesceTimer->stop();
+    writePending();
+}
+
+void PersistWorker::writePending() {
+    TraceSpan span("persist.write");
+    if (snapshotPending) {
+        snapshotPending = false;
+        TaskTable tasks = snapshotTasks;
+        snapshotTasks = TaskTable(); // 写完就释放，不再占着一份副本
+
+        // 先写快照再换日志；两步之间崩溃时旧日志代数对不上，加载时会被忽略
+        logFile.close();
+        if (TaskJournal::writeSnapshot(snapshotPath, tasks, snapshotGeneration) &&
+            TaskJournal::writeJournalHeader(logPath, snapshotGeneration)) {
+            supersededLines.clear();
+            const QFileInfo info(snapshotPath);
+            emit snapshotWritten(snapshotGeneration, info.size(), info.lastModified().toMSecsSinceEpoch());
+            // 格式转换完成，另一种格式的旧快照已经没用了
+            if (QFile::exists(altPath))
+                QFile::remove(altPath);
+        } else {
+            // 快照没写成：旧快照 + 旧日志还是完整的，把这些行照常补进日志
+            qWarning() << "Z-Td: failed to write snapshot" << snapshotPath;
+            pendingLines.prepend(supersededLines);
+            supersededLines.clear();
+        }
+    }
+
+    if (pendingLines.isEmpty())
+        return;
+
+    if (!logFile.isOpen()) {
+        logFile.setFileName(logPath);
+        if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "Z-Td: cannot open journal" << logPath;
+            return;
+        }
+    }
+    // 一次 write + flush 写完整批，进程崩溃最多丢掉最后半行
+    logFile.write(pendingLines);
+    logFile.flush();
+    pendingLines.clear();
+}
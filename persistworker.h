@@ -0,0 +1,48 @@
+#ifndef PERSISTWORKER_H
+#define PERSISTWORKER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 持久化工作线程 ---
+// 住在单独的 QThread 里，所有磁盘 I/O 都在这里做，界面线程只管把数据丢过来。
+// 一段时间窗口 (coalesceMs) 内收到的日志行和快照请求会合并成一次写入：
+// 新快照写成功后，之前还没写出去的日志行就作废 (它们已经包含在快照里了)。
+class PersistWorker : public QObject {
+    Q_OBJECT
+
+  public:
+    // altPath：另一种格式的旧快照，新快照写成功后删掉，免得两份并存
+    PersistWorker(const QString &snapshotPath, const QString &altPath, const QString &logPath, int coalesceMs);
+
+    // 以下函数都只能在工作线程里调用 (界面线程用 QMetaObject::invokeMethod 投递过来)
+    void appendLines(const QByteArray &lines);
+    void requestSnapshot(const TaskTable &tasks, quint64 generation);
+    void flush(); // 立刻把手上攒着的全部写盘
+
+  signals:
+    // 快照写好了：文件大小和修改时间就是"自己写的"那一版的记号，监视文件时靠它认出别人的改动
+    void snapshotWritten(quint64 generation, qint64 size, qint64 modifiedMs);
+
+  private:
+    void writePending();
+
+    QString snapshotPath;
+    QString altPath;
+    QString logPath;
+    QFile logFile;
+    QTimer *coalesceTimer;
+
+    QByteArray pendingLines;
+    QByteArray supersededLines; // 已经包含在待写快照里的日志行；快照写失败时还得把它们补进日志
+    bool snapshotPending = false;
+    TaskTable snapshotTasks; // 不可变快照 (隐式共享，界面线程改动时会自己复制一份)
+    quint64 snapshotGeneration = 0;
+};
+
+#endif // PERSISTWORKER_H
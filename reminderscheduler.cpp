@@ -0,0 +1,200 @@
+#include "reminderscheduler.h"
+#include "tracer.h"
+#include <QDateTime>
+#include <algorithm>
+
+// 这么近的都算同一批，一起报
+static const qint64 GROUP_WINDOW_MS = 60 * 1000;
+// 最多睡这么久就醒来重新看一眼 (电脑休眠过、改了系统时间都能跟上)
+static const qint64 MAX_WAIT_MS = 3600 * 1000;
+
+ReminderScheduler::ReminderScheduler(QObject *parent) : QObject(parent), remindAt(9, 0) {
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    // 提醒精确到秒就够了，VeryCoarse 不会为了几毫秒多唤醒
+    timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(timer, &QTimer::timeout, this, &ReminderScheduler::fire);
+}
+
+void ReminderScheduler::setRemindAt(const QTime &time) {
+    const QTime value = time.isValid() ? time : QTime(9, 0);
+    if (value == remindAt)
+        return;
+    remindAt = value;
+    dayTimes.clear();
+    rebuild();
+}
+
+void ReminderScheduler::attach(TaskModel *taskModel) {
+    if (taskModel && taskModel == model)
+        return;
+    for (const QMetaObject::Connection &connection : connections)
+        disconnect(connection);
+    connections.clear();
+    model = taskModel;
+
+    if (taskModel) {
+        connections.append(connect(taskModel, &QAbstractItemModel::rowsInserted, this,
+                                   [this](const QModelIndex &, int first, int last) { updateRows(first, last); }));
+        // 只有日期和完成状态影响提醒，改标题的不用管
+        connections.append(connect(taskModel, &QAbstractItemModel::dataChanged, this,
+                                   [this](const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                          const QList<int> &roles) {
+                                       if (roles.isEmpty() || roles.contains(TaskModel::DateRole) ||
+                                           roles.contains(Qt::CheckStateRole))
+                                           updateRows(topLeft.row(), bottomRight.row());
+                                   }));
+        connections.append(connect(taskModel, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+                                   [this](const QModelIndex &, int first, int last) { cancelRows(first, last); }));
+        connections.append(connect(taskModel, &QAbstractItemModel::modelReset, this, &ReminderScheduler::rebuild));
+    }
+    rebuild();
+}
+
+void ReminderScheduler::rebuild() {
+    TraceSpan span("reminders.rebuild");
+    heap.clear();
+    slot.clear();
+    if (model) {
+        // 先把要排的全装进去，再自底向上建堆：O(n)，比一条条插快
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const int rows = model->rowCount();
+        for (int row = 0; row < rows; ++row) {
+            const qint32 day = model->dueDay(row);
+            if (!day || model->isDone(row))
+                continue;
+            const qint64 at = fireTime(day);
+            if (at > now)
+                heap.append({at, model->taskId(row)});
+        }
+        quint32 maxId = 0;
+        for (const Entry &entry : std::as_const(heap))
+            maxId = std::max(maxId, entry.id);
+        slot.fill(-1, heap.isEmpty() ? 0 : static_cast<int>(maxId) + 1);
+        for (int i = 0; i < heap.size(); ++i)
+            slot[heap[i].id] = i;
+        for (int i = heap.size() / 2 - 1; i >= 0; --i)
+            siftDown(i);
+    }
+    arm();
+}
+
+void ReminderScheduler::updateRows(int first, int last) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int row = first; row <= last; ++row) {
+        const quint32 id = model->taskId(row);
+        const qint32 day = model->dueDay(row);
+        const qint64 at = day && !model->isDone(row) ? fireTime(day) : 0;
+        if (at > now)
+            schedule(id, at);
+        else
+            cancel(id);
+    }
+    arm();
+}
+
+void ReminderScheduler::cancelRows(int first, int last) {
+    for (int row = first; row <= last; ++row)
+        cancel(model->taskId(row));
+    arm();
+}
+
+void ReminderScheduler::schedule(quint32 id, qint64 at) {
+    if (id >= static_cast<quint32>(slot.size()))
+        slot.resize(id + 1, -1);
+    int i = slot[id];
+    if (i < 0) {
+        heap.append({at, id});
+        i = heap.size() - 1;
+        slot[id] = i;
+        siftUp(i);
+        return;
+    }
+    // 改期：原地调整，往哪边挪看是提前还是推后
+    const qint64 old = heap[i].at;
+    heap[i].at = at;
+    if (at < old)
+        siftUp(i);
+    else if (at > old)
+        siftDown(i);
+}
+
+void ReminderScheduler::cancel(quint32 id) {
+    if (id >= static_cast<quint32>(slot.size()) || slot[id] < 0)
+        return;
+    const int i = slot[id];
+    slot[id] = -1;
+    const Entry last = heap.takeLast();
+    if (i == heap.size())
+        return; // 摘掉的就是最后一个
+    // 最后一个补到空位上，再往上或往下挪到该在的地方
+    place(i, last);
+    siftUp(i);
+    siftDown(slot[last.id]);
+}
+
+qint64 ReminderScheduler::fireTime(qint32 day) {
+    auto it = dayTimes.constFind(day);
+    if (it != dayTimes.cend())
+        return *it;
+    const qint64 at = QDateTime(QDate::fromJulianDay(day), remindAt).toMSecsSinceEpoch();
+    dayTimes.insert(day, at);
+    return at;
+}
+
+void ReminderScheduler::place(int i, const Entry &entry) {
+    heap[i] = entry;
+    slot[entry.id] = i;
+}
+
+void ReminderScheduler::siftUp(int i) {
+    const Entry entry = heap[i];
+    while (i > 0) {
+        const int parent = (i - 1) / 2;
+        if (heap[parent].at <= entry.at)
+            break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, entry);
+}
+
+void ReminderScheduler::siftDown(int i) {
+    const Entry entry = heap[i];
+    const int count = heap.size();
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count && heap[child + 1].at < heap[child].at)
+            ++child;
+        if (entry.at <= heap[child].at)
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, entry);
+}
+
+void ReminderScheduler::arm() {
+    if (heap.isEmpty()) {
+        timer->stop();
+        return;
+    }
+    const qint64 wait = heap.first().at - QDateTime::currentMSecsSinceEpoch();
+    timer->start(static_cast<int>(std::clamp<qint64>(wait, 0, MAX_WAIT_MS)));
+}
+
+void ReminderScheduler::fire() {
+    // 到点的和一分钟之内就要到点的一起拿出来，合成一条通知
+    const qint64 until = QDateTime::currentMSecsSinceEpoch() + GROUP_WINDOW_MS;
+    QVector<quint32> due;
+    while (!heap.isEmpty() && heap.first().at <= until) {
+        const quint32 id = heap.first().id;
+        due.append(id);
+        cancel(id);
+    }
+    arm();
+    if (!due.isEmpty())
+        emit remindersDue(due);
+}
@@ -0,0 +1,64 @@
+#ifndef REMINDERSCHEDULER_H
+#define REMINDERSCHEDULER_H
+
+#include <QHash>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QTime>
+#include <QTimer>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 到期提醒 ---
+// 没完成、有截止日期的任务，到期那天的 remindAt (默认 9:00) 提醒一次。
+// 所有提醒放在一个按时间排的二叉最小堆里，另外按任务编号记着每条在堆里的位置，
+// 改期、勾完成、删除都是 O(log n) 地原地调整或摘掉，整个调度器只有一个定时器，定在堆顶那一刻。
+// 同一时刻 (GROUP_WINDOW_MS 之内) 到期的一起报，一次 remindersDue。
+// 只排以后的提醒：已经过了点的 (包括刚改成今天、但今天的点已经过了的) 不补报。
+class ReminderScheduler : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit ReminderScheduler(QObject *parent = nullptr);
+
+    void setRemindAt(const QTime &time); // 不合法时用 9:00
+    // 挂到清单的模型上 (整张表一次建堆)；nullptr 表示卸下。同一个模型重复挂什么也不做
+    void attach(TaskModel *model);
+
+    int pendingCount() const { return heap.size(); }
+    qint64 nextWakeup() const { return heap.isEmpty() ? -1 : heap.first().at; } // 毫秒时间戳，-1 = 没有
+
+  signals:
+    // 这些任务 (编号) 到点了，已经从堆里拿掉
+    void remindersDue(const QVector<quint32> &ids);
+
+  private:
+    struct Entry {
+        qint64 at; // 提醒时刻 (毫秒时间戳)
+        quint32 id;
+    };
+
+    void rebuild();
+    void updateRows(int first, int last);
+    void cancelRows(int first, int last);
+    void schedule(quint32 id, qint64 at);
+    void cancel(quint32 id);
+    qint64 fireTime(qint32 day);
+    void place(int i, const Entry &entry);
+    void siftUp(int i);
+    void siftDown(int i);
+    void arm();
+    void fire();
+
+    QPointer<TaskModel> model;
+    QVector<QMetaObject::Connection> connections;
+    QVector<Entry> heap;
+    QVector<int> slot;              // 下标是任务编号，值是它在堆里的位置，-1 = 没排
+    QHash<qint32, qint64> dayTimes; // 儒略日 -> 那天提醒时刻 (时区换算很慢，同一天只算一次)
+    QTime remindAt;
+    QTimer *timer;
+};
+
+#endif // REMINDERSCHEDULER_H
@@ -0,0 +1,102 @@
+#include "singleinstance.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QLockFile>
+
+// 连接 / 写入最多等这么久 (毫秒)；对方在同一台机器上，正常不到 1 毫秒
+const int CONNECT_TIMEOUT_MS = 200;
+const int WRITE_TIMEOUT_MS = 1000;
+
+SingleInstance::SingleInstance(QObject *parent) : QObject(parent) {
+}
+
+QString SingleInstance::serverName() {
+    // 按程序目录 + 用户名区分：不同目录里的两份绿色版各用各的数据，可以同时开
+    QByteArray key = QDir(QCoreApplication::applicationDirPath()).canonicalPath().toUtf8();
+    key += '|' + qgetenv("USERNAME") + qgetenv("USER");
+    return "Z-Td-" + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex().left(16);
+}
+
+bool SingleInstance::isRunning() {
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    return socket.waitForConnected(CONNECT_TIMEOUT_MS);
+}
+
+bool SingleInstance::forwardToRunning(const QStringList &arguments) {
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS))
+        return false;
+
+    // 长度前缀 + QStringList，对方读够了就处理
+    QByteArray payload;
+    QDataStream(&payload, QIODevice::WriteOnly) << arguments;
+    QByteArray message;
+    QDataStream(&message, QIODevice::WriteOnly) << quint32(payload.size());
+    message += payload;
+    socket.write(message);
+    if (!socket.waitForBytesWritten(WRITE_TIMEOUT_MS)) {
+        qWarning() << "Z-Td: cannot forward arguments to the running instance";
+        return false;
+    }
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState)
+        socket.waitForDisconnected(WRITE_TIMEOUT_MS);
+    return true;
+}
+
+SingleInstance::ListenResult SingleInstance::listen() {
+    server = new QLocalServer(this);
+    // 只让当前用户连
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server->listen(serverName())) {
+        if (server->serverError() != QAbstractSocket::AddressInUseError) {
+            qWarning() << "Z-Td: single-instance server:" << server->errorString();
+            return ListenFailed;
+        }
+        // 名字被占了：连得上就是另一个实例 (哪怕它还在建窗口)，交给它
+        if (isRunning())
+            return AlreadyRunning;
+        // 连不上是上次崩溃留下的套接字文件 (Unix)，清掉再占。清理要加锁：
+        // 同时启动的两个都看到旧文件时，后拿到锁的那个会连上先来的，而不是把它的套接字删掉
+        QLockFile lock(QDir(QDir::tempPath()).filePath(serverName() + ".lock"));
+        lock.lock();
+        if (isRunning())
+            return AlreadyRunning;
+        QLocalServer::removeServer(serverName());
+        if (!server->listen(serverName())) {
+            if (server->serverError() == QAbstractSocket::AddressInUseError && isRunning())
+                return AlreadyRunning;
+            qWarning() << "Z-Td: single-instance server:" << server->errorString();
+            return ListenFailed;
+        }
+    }
+
+    connect(server, &QLocalServer::newConnection, this, [this]() {
+        while (QLocalSocket *socket = server->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            auto readMessage = [this, socket]() {
+                // 数据可能分几次到：等长度前缀说的字节都齐了再解析
+                if (socket->bytesAvailable() < qint64(sizeof(quint32)))
+                    return;
+                quint32 size = 0;
+                QDataStream(socket->peek(sizeof(quint32))) >> size;
+                if (socket->bytesAvailable() < qint64(sizeof(quint32)) + size)
+                    return;
+                socket->read(sizeof(quint32));
+                QStringList arguments;
+                QDataStream(socket->read(size)) >> arguments;
+                emit argumentsReceived(arguments);
+            };
+            connect(socket, &QLocalSocket::readyRead, this, readMessage);
+            readMessage(); // 连接建立时可能已经收到了
+        }
+    });
+    return Listening;
+}
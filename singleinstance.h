@@ -0,0 +1,39 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+
+// --- 单实例 ---
+// 同一个程序目录 (也就是同一份任务文件) 同一个用户只跑一个 Z-Td。
+// 第二次启动时连上已经在跑的那个，把命令行参数通过本地套接字 (Windows 上是命名管道) 转过去就退出，
+// 不建窗口、不读任务、不查天气，两个进程也就不会互相覆盖 todo_data.json。
+class SingleInstance : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit SingleInstance(QObject *parent = nullptr);
+
+    enum ListenResult { Listening, AlreadyRunning, ListenFailed };
+
+    // 已经有实例在跑：把 arguments 转过去，返回 true (调用方直接退出)
+    bool forwardToRunning(const QStringList &arguments);
+    // 占下这个名字，之后别的启动转过来的参数从 argumentsReceived 出来 (事件循环跑起来以后)。
+    // 要在建窗口之前调：名字被一个连得上的实例占着 (它可能还在启动) 就返回 AlreadyRunning
+    ListenResult listen();
+
+    // 只探测一下有没有实例在跑 (命令行模式改数据前用)
+    static bool isRunning();
+
+  signals:
+    void argumentsReceived(const QStringList &arguments);
+
+  private:
+    static QString serverName();
+
+    QLocalServer *server = nullptr;
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,89 @@
+#include "startupprofiler.h"
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QSettings>
+#include <QVector>
+
+namespace {
+
+struct Stage {
+    const char *name;
+    qint64 end; // Tracer::now() 的纳秒
+};
+
+qint64 beginTime = -1;
+QVector<Stage> stages;
+bool finished = false;
+
+qint64 toMs(qint64 ns) {
+    return ns / 1000000;
+}
+
+QString logPath() {
+    const QByteArray env = qgetenv("ZTD_STARTUP_REPORT");
+    if (!env.isEmpty() && env != "0" && env != "1")
+        return QString::fromLocal8Bit(env);
+    const bool on = (!env.isEmpty() && env != "0") || QSettings("MySoft", "ToDoList").value("startupReport", false).toBool();
+    return on ? QCoreApplication::applicationDirPath() + "/ztd-startup.log" : QString();
+}
+
+} // namespace
+
+void StartupProfiler::begin() {
+    // Tracer 的时间原点就在第一次取时间的时候，这里顺便把它定在进程刚开始
+    beginTime = Tracer::now();
+    stages.reserve(16);
+}
+
+void StartupProfiler::mark(const char *stage) {
+    if (beginTime < 0 || finished)
+        return;
+    const qint64 now = Tracer::now();
+    const qint64 start = stages.isEmpty() ? beginTime : stages.last().end;
+    stages.append({stage, now});
+    if (Tracer::isEnabled())
+        Tracer::record(stage, start, now);
+}
+
+qint64 StartupProfiler::elapsedMs() {
+    return beginTime < 0 ? 0 : toMs(Tracer::now() - beginTime);
+}
+
+bool StartupProfiler::isFinished() {
+    return finished;
+}
+
+QString StartupProfiler::report() {
+    QString text;
+    qint64 previous = beginTime;
+    for (const Stage &stage : stages) {
+        text += QString("%1 %2 ms  (+%3 ms)\n")
+                    .arg(QString::fromLatin1(stage.name), -22)
+                    .arg(toMs(stage.end - beginTime), 5)
+                    .arg(toMs(stage.end - previous));
+        previous = stage.end;
+    }
+    return text;
+}
+
+void StartupProfiler::finish() {
+    if (beginTime < 0 || finished)
+        return;
+    mark("startup.done");
+    finished = true;
+    qInfo().noquote() << "Z-Td startup:\n" + report();
+
+    const QString path = logPath();
+    if (path.isEmpty())
+        return;
+    // 一次启动一行：时间戳 + 各阶段到达的时刻
+    QString line = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    for (const Stage &stage : stages)
+        line += QString(" %1=%2").arg(QString::fromLatin1(stage.name)).arg(toMs(stage.end - beginTime));
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        file.write(line.toUtf8() + '\n');
+}
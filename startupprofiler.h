@@ -0,0 +1,22 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QString>
+
+// --- 启动计时 ---
+// main 第一行 begin()，之后每做完一个阶段 mark("名字")，全部做完 finish()。
+// 每个阶段的耗时同时记进 Tracer (开了跟踪就能在时间线上看到)，
+// finish() 时打印一张表，设置了 ZTD_STARTUP_REPORT=1 (或 =文件路径) / 设置项 startupReport=true 时
+// 再往 ztd-startup.log 追加一行，方便长期盯着首帧时间。
+class StartupProfiler {
+  public:
+    static void begin();
+    static void mark(const char *stage); // 必须是字符串字面量 (只存指针)
+    static void finish();
+    static bool isFinished();
+
+    static qint64 elapsedMs(); // 从 begin() 到现在
+    static QString report();   // 各阶段的耗时表
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,577 @@
+#include "syncengine.h"
+#include "tracer.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QSettings>
+#include <QUuid>
+#include <algorithm>
+#include <functional>
+
+static const int SYNC_DELAY_MS = 3000;         // 本地改完等这么久再发，连着改的攒成一批
+static const int REQUEST_TIMEOUT_MS = 30 * 1000;
+static const int RETRY_BASE_MS = 5 * 1000;
+static const int RETRY_MAX_MS = 600 * 1000;
+static const quint32 STATE_MAGIC = 0x5A544453; // "ZTDS"
+static const quint32 STATE_VERSION = 1;
+
+SyncEngine::SyncEngine(QNetworkAccessManager *net, const QUrl &endpoint, QObject *parent)
+    : QObject(parent), net(net), endpoint(endpoint), device(deviceId()) {
+    debounceTimer = new QTimer(this);
+    debounceTimer->setSingleShot(true);
+    debounceTimer->setInterval(SYNC_DELAY_MS);
+    connect(debounceTimer, &QTimer::timeout, this, &SyncEngine::sync);
+
+    retryTimer = new QTimer(this);
+    retryTimer->setSingleShot(true);
+    retryTimer->setTimerType(Qt::VeryCoarseTimer);
+    connect(retryTimer, &QTimer::timeout, this, &SyncEngine::sync);
+}
+
+SyncEngine::~SyncEngine() {
+    detach();
+}
+
+QString SyncEngine::deviceId() {
+    QSettings settings("MySoft", "ToDoList");
+    QString id = settings.value("syncDeviceId").toString();
+    if (id.isEmpty()) {
+        id = QUuid::createUuid().toString(QUuid::Id128).left(16);
+        settings.setValue("syncDeviceId", id);
+    }
+    return id;
+}
+
+QString SyncEngine::statePathFor(const QString &snapshotPath) {
+    const QFileInfo info(snapshotPath);
+    return info.path() + "/" + info.completeBaseName() + ".sync";
+}
+
+void SyncEngine::attach(TaskModel *taskModel, const QString &name, const QString &path) {
+    detach();
+    if (!taskModel)
+        return;
+    TraceSpan span("sync.attach");
+    model = taskModel;
+    listName = name;
+    statePath = path;
+    loadState();
+    for (auto it = stamps.cbegin(); it != stamps.cend(); ++it)
+        if (it->id)
+            uidForId.insert(it->id, it.key());
+
+    // 只记编号，比指纹和盖戳留到真要发的时候
+    connections.append(connect(taskModel, &QAbstractItemModel::rowsInserted, this,
+                               [this](const QModelIndex &, int first, int last) { markDirty(first, last); }));
+    connections.append(connect(taskModel, &QAbstractItemModel::dataChanged, this,
+                               [this](const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                      const QList<int> &roles) {
+                                   // 顺序键被重新拉开是本机自己定的，应用服务器的改动时挤出来的也要发
+                                   // (键其实没变的，比指纹时会跳过)
+                                   if (applyingRemote && roles.contains(TaskModel::RankRole)) {
+                                       for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+                                           dirtyIds.insert(model->taskId(row));
+                                       scheduleSync();
+                                       return;
+                                   }
+                                   markDirty(topLeft.row(), bottomRight.row());
+                               }));
+    // 拖动排序：挪过的几条换了顺序键，现在在 [first, first + count)
+    connections.append(connect(taskModel, &QAbstractItemModel::rowsMoved, this,
+                               [this](const QModelIndex &, int start, int end, const QModelIndex &, int row) {
+                                   const int count = end - start + 1;
+                                   const int first = row < start ? row : row - count;
+                                   markDirty(first, first + count - 1);
+                               }));
+    // 外部改动整表重排过：只有换了键的那些要发
+    connections.append(connect(taskModel, &TaskModel::ranksApplied, this,
+                               [this](const QVector<QPair<quint32, quint64>> &ranks) {
+                                   if (applyingRemote)
+                                       return;
+                                   for (const auto &entry : ranks)
+                                       dirtyIds.insert(entry.first);
+                                   scheduleSync();
+                               }));
+    connections.append(connect(taskModel, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+                               [this](const QModelIndex &, int first, int last) { removeRowsStamped(first, last); }));
+    // 一遍压缩删掉已完成的、外部合并等走的是 reset，不知道具体动了哪些，整个对一遍
+    connections.append(connect(taskModel, &QAbstractItemModel::modelReset, this, [this]() {
+        if (applyingRemote)
+            return;
+        rescan();
+        scheduleSync();
+    }));
+
+    // 从来没同步过的清单：已有的任务按内容起 uid，同一份文件拷到几台机器上也不会各传一份
+    seeding = stamps.isEmpty() && cursor == 0;
+    rescan();
+    collectChanges();
+    seeding = false;
+    seedCounts.clear();
+    sync();
+}
+
+void SyncEngine::detach() {
+    if (statePath.isEmpty())
+        return;
+    debounceTimer->stop();
+    retryTimer->stop();
+    retryPending = false;
+    for (const QMetaObject::Connection &connection : connections)
+        disconnect(connection);
+    connections.clear();
+    collectChanges();
+    if (inFlight) {
+        // 服务器可能已经收下了，没关系：下次重发同一个版本它会忽略
+        QNetworkReply *reply = inFlight;
+        inFlight = nullptr;
+        reply->abort();
+    }
+    sending.clear();
+    again = false;
+    roundStarted = -1;
+    saveState();
+
+    model = nullptr;
+    listName.clear();
+    statePath.clear();
+    stamps.clear();
+    uidForId.clear();
+    dirtyIds.clear();
+    outbox.clear();
+    cursor = clock = uidCounter = 0;
+    failures = 0;
+}
+
+void SyncEngine::loadState() {
+    stamps.clear();
+    outbox.clear();
+    cursor = clock = uidCounter = 0;
+    QFile file(statePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return; // 还没同步过
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != STATE_MAGIC || version != STATE_VERSION) {
+        qWarning() << "Z-Td: ignoring unknown sync state" << statePath;
+        return;
+    }
+    QString savedList, savedDevice;
+    in >> savedList >> savedDevice >> cursor >> clock >> uidCounter >> stamps >> outbox;
+    if (in.status() != QDataStream::Ok) {
+        // 读坏了就当没同步过：uid 按内容重新对，最多多传一遍
+        qWarning() << "Z-Td: corrupt sync state" << statePath;
+        stamps.clear();
+        outbox.clear();
+        cursor = clock = uidCounter = 0;
+        return;
+    }
+    // 清单改过名：服务器上是另一个清单了，从头拉 (本地的版本戳照样有效)
+    if (savedList != listName)
+        cursor = 0;
+    // 连同状态文件一起从别的机器拷过来的：uid 计数器是那台机器的，换个前缀就不会撞
+    if (savedDevice != device)
+        uidCounter = 0;
+}
+
+void SyncEngine::saveState() {
+    if (!stateDirty || statePath.isEmpty())
+        return;
+    TraceSpan span("sync.saveState");
+    QSaveFile file(statePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Z-Td: cannot write sync state" << statePath;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << STATE_MAGIC << STATE_VERSION << listName << device << cursor << clock << uidCounter << stamps << outbox;
+    if (file.commit())
+        stateDirty = false;
+}
+
+void SyncEngine::rescan() {
+    if (!model)
+        return;
+    for (int row = 0; row < model->rowCount(); ++row)
+        dirtyIds.insert(model->taskId(row));
+    // 上次还在、现在找不到的：没挂着的时候被删掉了
+    for (auto it = stamps.begin(); it != stamps.end(); ++it) {
+        if (!it->id || model->rowForId(it->id) >= 0)
+            continue;
+        uidForId.remove(it->id);
+        it->version = ++clock;
+        it->device = device;
+        it->hash = 0;
+        it->id = 0;
+        SyncChange change;
+        change.uid = it.key();
+        change.version = it->version;
+        change.device = device;
+        change.deleted = true;
+        outbox.insert(change.uid, change);
+        stateDirty = true;
+    }
+}
+
+void SyncEngine::collectChanges() {
+    if (!model || dirtyIds.isEmpty())
+        return;
+    for (const quint32 id : std::as_const(dirtyIds)) {
+        const int row = model->rowForId(id);
+        if (row < 0)
+            continue;
+        const quint64 hash = fingerprint(row);
+        QString uid = uidForId.value(id);
+        if (uid.isEmpty()) {
+            uid = newUid(row);
+            uidForId.insert(id, uid);
+        }
+        Stamp &stamp = stamps[uid];
+        if (stamp.version && stamp.id == id && stamp.hash == hash)
+            continue; // 改回了原样
+        stamp.version = ++clock;
+        stamp.device = device;
+        stamp.hash = hash;
+        stamp.id = id;
+        outbox.insert(uid, changeFor(uid, stamp, row));
+        stateDirty = true;
+    }
+    dirtyIds.clear();
+}
+
+void SyncEngine::markDirty(int first, int last) {
+    if (applyingRemote)
+        return;
+    for (int row = first; row <= last; ++row)
+        dirtyIds.insert(model->taskId(row));
+    scheduleSync();
+}
+
+void SyncEngine::removeRowsStamped(int first, int last) {
+    if (applyingRemote)
+        return;
+    // 删除要趁行还在的时候盖戳 (删完就不知道是哪个 uid 了)
+    for (int row = first; row <= last; ++row) {
+        const quint32 id = model->taskId(row);
+        dirtyIds.remove(id);
+        const QString uid = uidForId.take(id);
+        if (uid.isEmpty())
+            continue; // 还没发出去过的新任务，删了就删了
+        Stamp &stamp = stamps[uid];
+        stamp.version = ++clock;
+        stamp.device = device;
+        stamp.hash = 0;
+        stamp.id = 0;
+        SyncChange change;
+        change.uid = uid;
+        change.version = stamp.version;
+        change.device = device;
+        change.deleted = true;
+        outbox.insert(uid, change);
+        stateDirty = true;
+    }
+    scheduleSync();
+}
+
+quint64 SyncEngine::fingerprint(int row) const {
+    // FNV-1a，只用来判断内容变没变
+    quint64 hash = 14695981039346656037ULL;
+    auto feed = [&hash](const QString &text) {
+        for (const QChar c : text) {
+            hash ^= c.unicode();
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xFFFF; // 分隔，免得 "ab"+"c" 和 "a"+"bc" 一样
+        hash *= 1099511628211ULL;
+    };
+    feed(model->title(row));
+    feed(model->date(row));
+    hash ^= model->isDone(row) ? 1 : 2;
+    hash *= 1099511628211ULL;
+    hash ^= model->rank(row);
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+QString SyncEngine::newUid(int row) {
+    if (seeding) {
+        const QByteArray content = (model->date(row) + '\n' + model->title(row)).toUtf8();
+        const QByteArray key = QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex().left(16);
+        const int n = seedCounts[key]++;
+        return "h" + QString::fromLatin1(key) + "-" + QString::number(n);
+    }
+    return device + ":" + QString::number(++uidCounter, 36);
+}
+
+SyncChange SyncEngine::changeFor(const QString &uid, const Stamp &stamp, int row) const {
+    SyncChange change;
+    change.uid = uid;
+    change.version = stamp.version;
+    change.device = stamp.device;
+    change.title = model->title(row);
+    change.date = model->date(row);
+    change.done = model->isDone(row);
+    change.rank = model->rank(row);
+    return change;
+}
+
+int SyncEngine::applyRemote(const QVector<SyncChange> &changes) {
+    TraceSpan span("sync.apply");
+    QVector<TaskRecord> added;
+    QStringList addedUids;
+    QVector<int> removedRows;
+    QVector<QPair<quint32, quint64>> reorders; // 换了顺序键的 (本地编号, 新键)
+    QVector<QPair<QString, quint64>> touched;  // 内容变了的 (uid, 服务器给的键)，挪完位置再算指纹
+    int applied = 0;
+
+    applyingRemote = true;
+    for (const SyncChange &change : changes) {
+        if (change.uid.isEmpty())
+            continue;
+        const auto it = stamps.constFind(change.uid);
+        if (it != stamps.cend() && !SyncProtocol::isNewer(change.version, change.device, it->version, it->device))
+            continue; // 本地的更新 (或者就是自己发上去的那一版)
+        clock = std::max(clock, change.version);
+        outbox.remove(change.uid); // 本地没发出去的那一版输了
+
+        Stamp stamp = it != stamps.cend() ? *it : Stamp();
+        // 删除最后统一做，循环里的行号和编号对照表都不会变
+        const int row = stamp.id ? model->rowForId(stamp.id) : -1;
+        if (change.deleted) {
+            if (row >= 0)
+                removedRows.append(row);
+            uidForId.remove(stamp.id);
+            stamp.id = 0;
+            stamp.hash = 0;
+        } else if (row >= 0) {
+            if (model->title(row) != change.title)
+                model->setTitle(row, change.title);
+            if (model->date(row) != change.date)
+                model->setDate(row, change.date);
+            if (model->isDone(row) != change.done)
+                model->setDone(row, change.done);
+            if (change.rank && model->rank(row) != change.rank)
+                reorders.append({stamp.id, change.rank});
+            touched.append({change.uid, change.rank});
+        } else {
+            TaskRecord task;
+            task.title = change.title;
+            task.setDate(change.date);
+            task.done = change.done;
+            task.rank = change.rank;
+            added.append(task);
+            addedUids.append(change.uid);
+            stamp.id = 0; // 加进模型后再填
+        }
+        stamp.version = change.version;
+        stamp.device = change.device;
+        stamps.insert(change.uid, stamp);
+        ++applied;
+    }
+
+    // 从后往前删，连续的一段一次删掉
+    std::sort(removedRows.begin(), removedRows.end(), std::greater<int>());
+    for (int i = 0; i < removedRows.size();) {
+        int j = i + 1;
+        while (j < removedRows.size() && removedRows[j] == removedRows[j - 1] - 1)
+            ++j;
+        model->removeRows(removedRows[j - 1], j - i);
+        i = j;
+    }
+
+    // 新任务一批加到末尾 (一次 rowsInserted)；键排在已有的后面就照用，否则下面再挪到键的位置
+    if (!added.isEmpty()) {
+        const int first = model->rowCount();
+        model->appendTasks(added);
+        for (int i = 0; i < added.size(); ++i) {
+            Stamp &stamp = stamps[addedUids[i]];
+            stamp.id = model->taskId(first + i);
+            uidForId.insert(stamp.id, addedUids[i]);
+            if (added[i].rank && model->rank(first + i) != added[i].rank)
+                reorders.append({stamp.id, added[i].rank});
+            touched.append({addedUids[i], added[i].rank});
+        }
+    }
+
+    model->applyRanks(reorders);
+    for (const auto &entry : std::as_const(touched)) {
+        Stamp &stamp = stamps[entry.first];
+        const int row = stamp.id ? model->rowForId(stamp.id) : -1;
+        // 附近挤满被重新拉开、键和服务器的不一样了：指纹留空，下一轮当本地改动发出去
+        if (row >= 0)
+            stamp.hash = !entry.second || model->rank(row) == entry.second ? fingerprint(row) : 0;
+    }
+    applyingRemote = false;
+
+    if (applied)
+        stateDirty = true;
+    return applied;
+}
+
+void SyncEngine::sync() {
+    debounceTimer->stop();
+    retryTimer->stop();
+    retryPending = false;
+    if (!model)
+        return;
+    if (inFlight) {
+        again = true; // 这一轮结束时接着来
+        return;
+    }
+    if (roundStarted < 0) {
+        roundStarted = Tracer::isEnabled() ? Tracer::now() : 0;
+        roundSent = roundReceived = 0;
+    }
+    collectChanges();
+    send();
+}
+
+void SyncEngine::send() {
+    // 按版本从旧到新发，一批最多 BATCH_SIZE 条；中途断了也是先改的先到
+    QVector<const SyncChange *> order;
+    order.reserve(outbox.size());
+    for (const SyncChange &change : std::as_const(outbox))
+        order.append(&change);
+    const int count = std::min<int>(order.size(), SyncProtocol::BATCH_SIZE);
+    std::partial_sort(order.begin(), order.begin() + count, order.end(),
+                      [](const SyncChange *a, const SyncChange *b) { return a->version < b->version; });
+
+    QJsonArray changes;
+    sending.clear();
+    for (int i = 0; i < count; ++i) {
+        changes.append(SyncProtocol::toJson(*order[i]));
+        sending.append(qMakePair(order[i]->uid, order[i]->version));
+    }
+    QJsonObject body;
+    body["device"] = device;
+    body["list"] = listName;
+    body["since"] = static_cast<double>(cursor);
+    body["changes"] = changes;
+    QByteArray payload = QJsonDocument(body).toJson(QJsonDocument::Compact);
+
+    QUrl url = endpoint;
+    QString path = url.path();
+    if (!path.endsWith('/'))
+        path += '/';
+    url.setPath(path + "sync");
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setTransferTimeout(REQUEST_TIMEOUT_MS);
+    if (!token.isEmpty())
+        request.setRawHeader("Authorization", "Bearer " + token.toUtf8());
+    // 回复的解压 QNetworkAccessManager 自己会做 (它会带上 Accept-Encoding)
+    if (payload.size() > SyncProtocol::COMPRESS_THRESHOLD) {
+        payload = SyncProtocol::deflate(payload);
+        request.setRawHeader("Content-Encoding", "deflate");
+    }
+    inFlight = net->post(request, payload);
+    connect(inFlight, &QNetworkReply::finished, this, [this, reply = inFlight.data()]() { onFinished(reply); });
+}
+
+void SyncEngine::onFinished(QNetworkReply *reply) {
+    reply->deleteLater();
+    if (reply != inFlight)
+        return; // 卸下清单时扔掉的请求
+    inFlight = nullptr;
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+    if (!doc.isObject()) {
+        fail("同步服务器的回复不是 JSON");
+        return;
+    }
+    const QJsonObject response = doc.object();
+
+    // 请求途中的本地改动先盖上版本戳，再和服务器来的比新旧
+    collectChanges();
+    // 发上去的服务器都收下了；途中又改过的版本更高，留着下次发
+    for (const auto &sent : std::as_const(sending)) {
+        const auto it = outbox.find(sent.first);
+        if (it != outbox.end() && it->version == sent.second)
+            outbox.erase(it);
+    }
+    roundSent += sending.size();
+    sending.clear();
+
+    QVector<SyncChange> changes;
+    const QJsonArray array = response.value("changes").toArray();
+    changes.reserve(array.size());
+    for (const QJsonValue &value : array)
+        changes.append(SyncProtocol::fromJson(value.toObject()));
+    roundReceived += applyRemote(changes);
+    // 服务器的数据清空过时游标会变小，照它说的来
+    cursor = static_cast<quint64>(response.value("cursor").toDouble());
+    stateDirty = true;
+    failures = 0;
+
+    // 待发的还没发完、服务器那边还有，或者途中又要求过同步：接着下一个请求
+    again = false;
+    if (!outbox.isEmpty() || response.value("more").toBool()) {
+        send();
+        return;
+    }
+    saveState();
+    if (roundStarted > 0)
+        Tracer::record("sync.round", roundStarted, Tracer::now());
+    roundStarted = -1;
+    emit synced(roundSent, roundReceived);
+}
+
+void SyncEngine::fail(const QString &error) {
+    qWarning() << "Z-Td: sync failed:" << error;
+    sending.clear();
+    again = false;
+    roundStarted = -1;
+    ++failures;
+    saveState(); // 待发队列先落盘，程序关掉了下次也能接着发
+    scheduleRetry();
+    emit syncFailed(error);
+}
+
+void SyncEngine::scheduleSync() {
+    // 正在退避等重试的话就别催了，改动跟着那次重试一起发
+    if (retryTimer->isActive() || retryPending)
+        return;
+    if (inFlight) {
+        again = true;
+        return;
+    }
+    debounceTimer->start();
+}
+
+void SyncEngine::scheduleRetry() {
+    // 和天气一样：5s, 10s, 20s ... 封顶 10 分钟，在后一半区间里随机取一点
+    const int shift = qMin(failures - 1, 16);
+    const qint64 delay = qMin<qint64>(qint64(RETRY_BASE_MS) << shift, RETRY_MAX_MS);
+    const qint64 jittered = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    if (paused) {
+        retryPending = true;
+        return;
+    }
+    retryTimer->start(static_cast<int>(jittered));
+}
+
+void SyncEngine::pauseRetries() {
+    paused = true;
+    if (retryTimer->isActive()) {
+        retryTimer->stop();
+        retryPending = true;
+    }
+}
+
+void SyncEngine::resumeRetries() {
+    paused = false;
+    if (retryPending)
+        sync();
+}
@@ -0,0 +1,128 @@
+#ifndef SYNCENGINE_H
+#define SYNCENGINE_H
+
+#include <QHash>
+#include <QMap>
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include "syncprotocol.h"
+#include "taskmodel.h"
+
+// --- 增量同步 ---
+// 挂在当前清单的模型上，和自建的同步服务器 (协议见 SyncProtocol，参考实现是 SyncServer) 只交换改过的任务：
+// * 每条任务有全局编号 uid 和版本戳 (Lamport 版本 + 设备)，外加一个内容指纹，都记在分片旁边的 .sync 文件里；
+//   顺序键也算内容，拖动一条就是这一条的一次改动，收到别人的新键就把它挪过去；
+// * 模型的信号只记下哪些编号动过，真要发的时候才比指纹、盖版本戳，所以连着改十次也只发一条；
+// * 删除留墓碑 (带版本戳的删除记录)，免得别的机器又把它同步回来；
+// * 发不出去的改动攒在待发队列里，跟着 .sync 文件落盘，联网后按版本顺序分批重放；
+// * 挂上时把模型和上次的指纹对一遍，离线时命令行、外部编辑器改的也能找出来；
+// * 本地改动后等几秒再发 (攒成一批)，失败按指数退避 + 抖动重试，跟天气一样。
+class SyncEngine : public QObject {
+    Q_OBJECT
+
+  public:
+    // net 用现成的 (界面里是天气那个)，endpoint 是服务器根地址，比如 http://127.0.0.1:8745
+    SyncEngine(QNetworkAccessManager *net, const QUrl &endpoint, QObject *parent = nullptr);
+    ~SyncEngine() override;
+
+    // 本机的设备编号 (第一次用时生成，存在设置项 syncDeviceId 里)
+    static QString deviceId();
+    // 分片快照旁边的同步状态文件：todo_data.json -> todo_data.sync
+    static QString statePathFor(const QString &snapshotPath);
+
+    void setToken(const QString &value) { token = value.trimmed(); } // 服务器要求的口令 (Authorization: Bearer)
+
+    // 挂到一个已经加载完的清单上 (先把之前挂着的卸下来)
+    void attach(TaskModel *model, const QString &listName, const QString &statePath);
+    // 卸下来：没发的改动记进状态文件，下次挂上接着发
+    void detach();
+    bool isAttached() const { return !model.isNull(); }
+
+    void sync(); // 马上同步一轮 (正在进行时等它结束再来一轮)
+    int pendingCount() const { return outbox.size() + dirtyIds.size(); }
+
+    // 窗口藏起来时暂停重试；恢复时如果有重试欠着就立刻补一次
+    void pauseRetries();
+    void resumeRetries();
+
+  signals:
+    // 一轮同步 (可能是好几个请求) 结束：推上去多少条、收下多少条
+    void synced(int sent, int received);
+    void syncFailed(const QString &error);
+
+  private:
+    // 一条任务的同步状态；id 是本地任务编号，0 表示这是墓碑
+    struct Stamp {
+        quint64 version = 0;
+        QString device;
+        quint64 hash = 0;
+        quint32 id = 0;
+    };
+    friend QDataStream &operator<<(QDataStream &out, const Stamp &stamp) {
+        return out << stamp.version << stamp.device << stamp.hash << stamp.id;
+    }
+    friend QDataStream &operator>>(QDataStream &in, Stamp &stamp) {
+        return in >> stamp.version >> stamp.device >> stamp.hash >> stamp.id;
+    }
+
+    void loadState();
+    void saveState();
+    void rescan();         // 所有行都当作可能改过，再找出已经不在的 (墓碑)
+    void collectChanges(); // 动过的行比指纹，真变了才盖版本戳进待发队列
+    void markDirty(int first, int last);
+    void removeRowsStamped(int first, int last);
+    quint64 fingerprint(int row) const;
+    QString newUid(int row);
+    SyncChange changeFor(const QString &uid, const Stamp &stamp, int row) const;
+    int applyRemote(const QVector<SyncChange> &changes); // 返回真正用上的条数
+    void send();
+    void onFinished(QNetworkReply *reply);
+    void fail(const QString &error);
+    void scheduleSync(); // 本地改动后攒几秒再发
+    void scheduleRetry();
+
+    QNetworkAccessManager *net;
+    QUrl endpoint;
+    QString device;
+    QString token;
+
+    QPointer<TaskModel> model;
+    QString listName;
+    QString statePath;
+    QVector<QMetaObject::Connection> connections;
+
+    QHash<QString, Stamp> stamps;       // uid -> 状态 (包括墓碑)
+    QHash<quint32, QString> uidForId;   // 本地编号 -> uid
+    QSet<quint32> dirtyIds;             // 动过、还没比过指纹的本地编号
+    QMap<QString, SyncChange> outbox;   // 待发队列 (同一条只留最新的)
+    quint64 cursor = 0;                 // 服务器上已经拿到哪儿了
+    quint64 clock = 0;                  // Lamport 时钟
+    quint64 uidCounter = 0;
+    bool seeding = false;               // 第一次同步：已有任务按内容生成 uid，两台机器上的同一条能对上
+    QHash<QByteArray, int> seedCounts;  // 内容完全相同的任务各自编个序号
+    bool applyingRemote = false;        // 正在应用服务器来的改动，模型信号不算本地改动
+    bool stateDirty = false;
+
+    QPointer<QNetworkReply> inFlight; // 用 QPointer：退出时 QNetworkAccessManager 可能先没了，连带删掉请求
+    QVector<QPair<QString, quint64>> sending; // 这次发出去的 (uid, 版本)，成功后从待发队列里去掉
+    bool again = false;                       // 请求途中又要求同步了
+    int roundSent = 0;
+    int roundReceived = 0;
+    qint64 roundStarted = -1; // 跟踪用 (Tracer 纳秒)
+
+    QTimer *debounceTimer;
+    QTimer *retryTimer;
+    int failures = 0;
+    bool paused = false;
+    bool retryPending = false;
+};
+
+#endif // SYNCENGINE_H
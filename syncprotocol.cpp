@@ -0,0 +1,64 @@
+#include "syncprotocol.h"
+#include "taskmodel.h"
+
+QDataStream &operator<<(QDataStream &out, const SyncChange &change) {
+    return out << change.uid << change.version << change.device << change.deleted << change.title << change.date
+               << change.done << change.rank;
+}
+
+QDataStream &operator>>(QDataStream &in, SyncChange &change) {
+    return in >> change.uid >> change.version >> change.device >> change.deleted >> change.title >> change.date >>
+           change.done >> change.rank;
+}
+
+bool SyncProtocol::isNewer(quint64 version, const QString &device, quint64 otherVersion, const QString &otherDevice) {
+    if (version != otherVersion)
+        return version > otherVersion;
+    return device > otherDevice;
+}
+
+QJsonObject SyncProtocol::toJson(const SyncChange &change) {
+    QJsonObject object;
+    object["uid"] = change.uid;
+    // JSON 数字是 double，版本到 2^53 之前都是精确的，够用了
+    object["version"] = static_cast<double>(change.version);
+    object["device"] = change.device;
+    if (change.deleted) {
+        object["deleted"] = true;
+    } else {
+        object["title"] = change.title;
+        object["date"] = change.date;
+        object["done"] = change.done;
+        // 64 位的键放进 JSON 数字会丢精度，写成字符串
+        if (change.rank)
+            object["rank"] = TaskRecord::formatRank(change.rank);
+    }
+    return object;
+}
+
+SyncChange SyncProtocol::fromJson(const QJsonObject &object) {
+    SyncChange change;
+    const double version = object.value("version").toDouble();
+    change.device = object.value("device").toString();
+    if (version < 1 || change.device.isEmpty())
+        return change; // 没有版本戳的改动没法比新旧，当成坏数据
+    change.uid = object.value("uid").toString();
+    change.version = static_cast<quint64>(version);
+    change.deleted = object.value("deleted").toBool();
+    if (!change.deleted) {
+        change.title = object.value("title").toString();
+        change.date = object.value("date").toString();
+        change.done = object.value("done").toBool();
+        change.rank = TaskRecord::parseRank(object.value("rank").toString());
+    }
+    return change;
+}
+
+QByteArray SyncProtocol::deflate(const QByteArray &data) {
+    return qCompress(data).mid(4);
+}
+
+QByteArray SyncProtocol::inflate(const QByteArray &data) {
+    // qUncompress 要的长度头只是预估，给 0 它会自己按需扩大缓冲区
+    return qUncompress(QByteArray(4, '\0') + data);
+}
@@ -0,0 +1,51 @@
+#ifndef SYNCPROTOCOL_H
+#define SYNCPROTOCOL_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QJsonObject>
+#include <QString>
+
+// 同步时交换的一条改动：一条任务的最新内容 (或者它被删掉了)，带版本戳。
+// 版本是 Lamport 时钟：每台机器本地改一次加一，收到别人的更大版本就追上去；
+// 两边版本相同时按设备编号比大小，保证每台机器挑出的赢家都一样。
+struct SyncChange {
+    QString uid;        // 全局任务编号 (各台机器上的本地编号不一样，靠它对上号)
+    quint64 version = 0;
+    QString device;     // 最后改它的设备
+    bool deleted = false;
+    QString title;
+    QString date;
+    bool done = false;
+    quint64 rank = 0;   // 顺序键 (见 TaskModel)，0 = 旧客户端没发，顺序不动
+};
+
+QDataStream &operator<<(QDataStream &out, const SyncChange &change);
+QDataStream &operator>>(QDataStream &in, SyncChange &change);
+
+// --- 同步协议 ---
+// 只有一个接口，POST {服务器}/sync，请求和回复都是 JSON：
+//   请求 {"device": "...", "list": "清单名", "since": 游标, "changes": [改动...]}
+//   回复 {"cursor": 新游标, "more": 还有没有, "changes": [别人的改动...]}
+// 改动 {"uid", "version", "device", "title", "date", "done", "rank"}，删除的是 {"uid", "version", "device", "deleted": true}。
+// rank 是 16 位十六进制的顺序键：拖动排序也只是这一条任务的一次改动。
+// 服务器先收下推上来的 (版本更新的才算数)，再回给游标之后别人改过的，一次最多 BATCH_SIZE 条；
+// 超过 COMPRESS_THRESHOLD 字节的请求体用 deflate 压缩 (Content-Encoding: deflate)。
+class SyncProtocol {
+  public:
+    static constexpr int BATCH_SIZE = 500;
+    static constexpr int COMPRESS_THRESHOLD = 1024;
+    static constexpr quint16 DEFAULT_PORT = 8745;
+
+    // (version, device) 是否比 (otherVersion, otherDevice) 新
+    static bool isNewer(quint64 version, const QString &device, quint64 otherVersion, const QString &otherDevice);
+
+    static QJsonObject toJson(const SyncChange &change);
+    static SyncChange fromJson(const QJsonObject &object); // 缺 uid 的返回 uid 为空
+
+    // HTTP 的 deflate 就是 zlib 流，qCompress 的结果去掉前 4 字节的长度头即可
+    static QByteArray deflate(const QByteArray &data);
+    static QByteArray inflate(const QByteArray &data); // 数据坏了返回空
+};
+
+#endif // SYNCPROTOCOL_H
@@ -0,0 +1,283 @@
+#include "syncserver.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSet>
+#include <QTcpSocket>
+
+static const int SAVE_DELAY_MS = 1000;
+static const int MAX_HEADER_BYTES = 64 * 1024;
+static const qint64 MAX_BODY_BYTES = 64 * 1024 * 1024;
+static const quint32 STORE_MAGIC = 0x5A545353; // "ZTSS"
+static const quint32 STORE_VERSION = 1;
+
+static QByteArray reasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    default: return "Error";
+    }
+}
+
+static QByteArray errorBody(const QString &message) {
+    return QJsonDocument(QJsonObject{{"error", message}}).toJson(QJsonDocument::Compact);
+}
+
+SyncServer::SyncServer(const QString &storePath, const QString &token, QObject *parent)
+    : QObject(parent), storePath(storePath), token(token.trimmed().toUtf8()) {
+    server = new QTcpServer(this);
+    connect(server, &QTcpServer::newConnection, this, &SyncServer::onNewConnection);
+
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(saveTimer, &QTimer::timeout, this, &SyncServer::save);
+
+    load();
+}
+
+SyncServer::~SyncServer() {
+    if (saveTimer->isActive())
+        save();
+}
+
+bool SyncServer::listen(const QHostAddress &address, quint16 port) {
+    return server->listen(address, port);
+}
+
+void SyncServer::onNewConnection() {
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void SyncServer::onReadyRead(QTcpSocket *socket) {
+    QByteArray &buffer = buffers[socket];
+    buffer += socket->readAll();
+
+    // 一个连接上可以连着来好几个请求 (keep-alive)，凑齐一个处理一个
+    while (true) {
+        const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (buffer.size() > MAX_HEADER_BYTES)
+                respond(socket, 431, errorBody("header too large"), false, false);
+            return;
+        }
+
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() != 3) {
+            respond(socket, 400, errorBody("bad request line"), false, false);
+            return;
+        }
+        QHash<QByteArray, QByteArray> headers;
+        for (int i = 1; i < lines.size(); ++i) {
+            const qsizetype colon = lines[i].indexOf(':');
+            if (colon > 0)
+                headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+
+        // 只认 Content-Length；QNetworkAccessManager 发 QByteArray 时总会带上
+        if (headers.contains("transfer-encoding")) {
+            respond(socket, 411, errorBody("chunked bodies are not supported"), false, false);
+            return;
+        }
+        bool ok = true;
+        const qint64 length = headers.value("content-length", "0").toLongLong(&ok);
+        if (!ok || length < 0) {
+            respond(socket, 400, errorBody("bad content-length"), false, false);
+            return;
+        }
+        if (length > MAX_BODY_BYTES) {
+            respond(socket, 413, errorBody("body too large"), false, false);
+            return;
+        }
+        if (buffer.size() < headerEnd + 4 + length)
+            return; // 请求体还没收全
+
+        QByteArray body = buffer.mid(headerEnd + 4, length);
+        buffer.remove(0, headerEnd + 4 + length);
+
+        const QByteArray connection = headers.value("connection").toLower();
+        const bool keepAlive = requestLine[2] == "HTTP/1.1" ? connection != "close" : connection == "keep-alive";
+        QByteArray reply;
+        int status = 200;
+        if (headers.value("content-encoding").toLower() == "deflate") {
+            body = SyncProtocol::inflate(body);
+            if (body.isEmpty() && length > 0) {
+                status = 400;
+                reply = errorBody("bad deflate body");
+            }
+        }
+        if (status == 200)
+            status = handle(requestLine[0], requestLine[1], headers, body, reply);
+        const bool deflate =
+            headers.value("accept-encoding").contains("deflate") && reply.size() > SyncProtocol::COMPRESS_THRESHOLD;
+        respond(socket, status, reply, deflate, keepAlive);
+        if (!keepAlive)
+            return;
+    }
+}
+
+int SyncServer::handle(const QByteArray &method, const QByteArray &path, const QHash<QByteArray, QByteArray> &headers,
+                       const QByteArray &body, QByteArray &reply) {
+    // 客户端的地址可以带前缀 (http://host/ztd)，只看最后一段
+    const QByteArray route = path.left(path.indexOf('?'));
+    if (!route.endsWith("/sync")) {
+        reply = errorBody("not found");
+        return 404;
+    }
+    if (method != "POST") {
+        reply = errorBody("use POST");
+        return 405;
+    }
+    if (!token.isEmpty() && headers.value("authorization") != "Bearer " + token) {
+        reply = errorBody("bad token");
+        return 401;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(body);
+    if (!doc.isObject()) {
+        reply = errorBody("body is not a JSON object");
+        return 400;
+    }
+    reply = handleSync(doc.object());
+    return 200;
+}
+
+QByteArray SyncServer::handleSync(const QJsonObject &request) {
+    const QString listName = request.value("list").toString();
+    ListState &list = lists[listName];
+    quint64 since = static_cast<quint64>(request.value("since").toDouble());
+    // 客户端记得的比服务器有的还多：服务器的数据清空过，让它从头拉
+    if (since > list.seq)
+        since = 0;
+
+    // 先收推上来的：版本比现有的新才算数，收下的发个新序号
+    QSet<QString> accepted;
+    const QJsonArray pushed = request.value("changes").toArray();
+    for (const QJsonValue &value : pushed) {
+        const SyncChange change = SyncProtocol::fromJson(value.toObject());
+        if (change.uid.isEmpty())
+            continue;
+        auto it = list.entries.find(change.uid);
+        if (it != list.entries.end()) {
+            if (!SyncProtocol::isNewer(change.version, change.device, it->change.version, it->change.device))
+                continue;
+            list.bySeq.remove(it->seq);
+        } else {
+            it = list.entries.insert(change.uid, Entry());
+        }
+        it->change = change;
+        it->seq = ++list.seq;
+        list.bySeq.insert(it->seq, change.uid);
+        accepted.insert(change.uid);
+    }
+    if (!accepted.isEmpty())
+        saveTimer->start();
+
+    // 再回游标之后的；刚收下的就是请求方自己的，不用发回去
+    QJsonArray changes;
+    quint64 cursor = since;
+    bool more = false;
+    for (auto it = list.bySeq.upperBound(since); it != list.bySeq.end(); ++it) {
+        if (changes.size() >= SyncProtocol::BATCH_SIZE) {
+            more = true;
+            break;
+        }
+        cursor = it.key();
+        if (!accepted.contains(it.value()))
+            changes.append(SyncProtocol::toJson(list.entries.value(it.value()).change));
+    }
+
+    qInfo().noquote() << QString("sync %1 [%2]: %3 pushed, %4 accepted, %5 returned")
+                             .arg(request.value("device").toString(), listName)
+                             .arg(pushed.size())
+                             .arg(accepted.size())
+                             .arg(changes.size());
+
+    QJsonObject response;
+    response["cursor"] = static_cast<double>(cursor);
+    response["more"] = more;
+    response["changes"] = changes;
+    return QJsonDocument(response).toJson(QJsonDocument::Compact);
+}
+
+void SyncServer::respond(QTcpSocket *socket, int status, const QByteArray &body, bool deflate, bool keepAlive) {
+    const QByteArray payload = deflate ? SyncProtocol::deflate(body) : body;
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+    head += "Content-Type: application/json\r\n";
+    head += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n";
+    if (deflate)
+        head += "Content-Encoding: deflate\r\n";
+    if (status == 401)
+        head += "WWW-Authenticate: Bearer\r\n";
+    head += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    socket->write(head + payload);
+    if (!keepAlive)
+        socket->disconnectFromHost();
+}
+
+void SyncServer::load() {
+    if (storePath.isEmpty())
+        return;
+    QFile file(storePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return; // 第一次跑
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0, version = 0, listCount = 0;
+    in >> magic >> version >> listCount;
+    if (magic != STORE_MAGIC || version != STORE_VERSION) {
+        qWarning() << "Z-Td: unknown sync store" << storePath;
+        return;
+    }
+    for (quint32 i = 0; i < listCount && in.status() == QDataStream::Ok; ++i) {
+        QString name;
+        quint32 entryCount = 0;
+        ListState list;
+        in >> name >> list.seq >> entryCount;
+        for (quint32 j = 0; j < entryCount && in.status() == QDataStream::Ok; ++j) {
+            Entry entry;
+            in >> entry.change >> entry.seq;
+            list.bySeq.insert(entry.seq, entry.change.uid);
+            list.entries.insert(entry.change.uid, entry);
+        }
+        lists.insert(name, list);
+    }
+    if (in.status() != QDataStream::Ok)
+        qWarning() << "Z-Td: sync store is truncated" << storePath;
+}
+
+void SyncServer::save() {
+    if (storePath.isEmpty())
+        return;
+    QSaveFile file(storePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Z-Td: cannot write sync store" << storePath;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << STORE_MAGIC << STORE_VERSION << quint32(lists.size());
+    for (auto it = lists.cbegin(); it != lists.cend(); ++it) {
+        out << it.key() << it->seq << quint32(it->entries.size());
+        for (const Entry &entry : it->entries)
+            out << entry.change << entry.seq;
+    }
+    if (!file.commit())
+        qWarning() << "Z-Td: cannot write sync store" << storePath;
+}
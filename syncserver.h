@@ -0,0 +1,64 @@
+#ifndef SYNCSERVER_H
+#define SYNCSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QMap>
+#include <QObject>
+#include <QTcpServer>
+#include <QTimer>
+
+#include "syncprotocol.h"
+
+class QTcpSocket;
+
+// --- 参考同步服务器 ---
+// 协议 (见 SyncProtocol) 的最小实现，Z-Td --cli serve 跑起来，不需要任何外部服务就能测同步：
+// * 只懂 HTTP/1.1 的 POST /sync (带 Content-Length，支持 keep-alive 和 deflate 压缩的请求体 / 回复)；
+// * 每个清单一份 uid -> 最新改动 的表，每收下一条改动发一个递增序号，游标就是序号，
+//   拉取时按序号从游标往后找，不用扫整张表；
+// * 数据存在一个文件里 (QDataStream)，改动后过一秒合并写一次。
+class SyncServer : public QObject {
+    Q_OBJECT
+
+  public:
+    // storePath 为空时只放在内存里；token 不为空时请求必须带 Authorization: Bearer token
+    SyncServer(const QString &storePath, const QString &token, QObject *parent = nullptr);
+    ~SyncServer() override;
+
+    bool listen(const QHostAddress &address, quint16 port);
+    QString errorString() const { return server->errorString(); }
+    quint16 port() const { return server->serverPort(); }
+
+  private:
+    struct Entry {
+        SyncChange change;
+        quint64 seq = 0;
+    };
+    struct ListState {
+        quint64 seq = 0;              // 这个清单发出去的最大序号
+        QHash<QString, Entry> entries; // uid -> 最新一版
+        QMap<quint64, QString> bySeq;  // 序号 -> uid (每个 uid 只留最新的序号)
+    };
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+    // 处理一个完整的请求，返回回复的状态码，body 是回复内容
+    int handle(const QByteArray &method, const QByteArray &path, const QHash<QByteArray, QByteArray> &headers,
+               const QByteArray &body, QByteArray &reply);
+    QByteArray handleSync(const QJsonObject &request);
+    void respond(QTcpSocket *socket, int status, const QByteArray &body, bool deflate, bool keepAlive);
+    void load();
+    void save();
+
+    QTcpServer *server;
+    QHash<QTcpSocket *, QByteArray> buffers; // 每个连接上还没处理完的字节
+    QString storePath;
+    QByteArray token;
+    QHash<QString, ListState> lists;
+    QTimer *saveTimer;
+};
+
+#endif // SYNCSERVER_H
@@ -0,0 +1,159 @@
+#include "taskbinaryfile.h"
+#include <QSaveFile>
+#include <QtEndian>
+#include <climits>
+#include <cstring>
+
+static const char MAGIC[4] = {'Z', 'T', 'D', 'B'};
+static const quint16 FORMAT_VERSION = 1;
+static const int HEADER_SIZE = 32;
+static const int RECORD_SIZE = 28;
+
+// 记录里的标志位
+static const quint16 FLAG_DONE = 0x1;
+static const quint16 FLAG_RAW_DATE = 0x2; // 日期不是标准 yyyy-MM-dd，原样存进字符串堆
+
+TaskBinaryFile::~TaskBinaryFile() {
+    if (base)
+        file.unmap(const_cast<uchar *>(base));
+    file.close();
+}
+
+bool TaskBinaryFile::isBinary(const QString &path) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    char magic[4];
+    return f.read(magic, 4) == 4 && std::memcmp(magic, MAGIC, 4) == 0;
+}
+
+bool TaskBinaryFile::write(const QString &path, const TaskTable &tasks, quint64 generation) {
+    QByteArray table(tasks.size() * RECORD_SIZE, Qt::Uninitialized);
+    QByteArray heapBytes;
+    uchar *rec = reinterpret_cast<uchar *>(table.data());
+
+    for (int i = 0; i < tasks.size(); ++i) {
+        quint16 flags = tasks.isDone(i) ? FLAG_DONE : 0;
+        const qint32 day = tasks.dueDay(i);
+        QByteArray rawDate;
+
+        // 标准日期存成儒略日；其余 (空的、手改过的) 原样保存，保证来回转换不丢信息
+        if (!day) {
+            flags |= FLAG_RAW_DATE;
+            rawDate = tasks.dateText(i).toUtf8().left(0xFFFF);
+        }
+
+        QByteArray title = tasks.title(i).toUtf8();
+        quint32 offset = static_cast<quint32>(heapBytes.size());
+        heapBytes += rawDate;
+        heapBytes += title;
+
+        qToLittleEndian<qint32>(day, rec);
+        qToLittleEndian<quint32>(offset, rec + 4);
+        qToLittleEndian<quint32>(static_cast<quint32>(title.size()), rec + 8);
+        qToLittleEndian<quint16>(flags, rec + 12);
+        qToLittleEndian<quint16>(static_cast<quint16>(rawDate.size()), rec + 14);
+        qToLittleEndian<quint32>(tasks.row(i).id, rec + 16);
+        qToLittleEndian<quint64>(tasks.rank(i), rec + 20);
+        rec += RECORD_SIZE;
+    }
+
+    uchar header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, 4);
+    qToLittleEndian<quint16>(FORMAT_VERSION, header + 4);
+    qToLittleEndian<quint16>(RECORD_SIZE, header + 6);
+    qToLittleEndian<quint32>(static_cast<quint32>(tasks.size()), header + 8);
+    qToLittleEndian<quint64>(generation, header + 16);
+    qToLittleEndian<quint64>(static_cast<quint64>(heapBytes.size()), header + 24);
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    out.write(reinterpret_cast<const char *>(header), HEADER_SIZE);
+    out.write(table);
+    out.write(heapBytes);
+    return out.commit();
+}
+
+QSharedPointer<TaskBinaryFile> TaskBinaryFile::open(const QString &path) {
+    QSharedPointer<TaskBinaryFile> bin(new TaskBinaryFile);
+    bin->file.setFileName(path);
+    if (!bin->file.open(QIODevice::ReadOnly))
+        return {};
+
+    const qint64 size = bin->file.size();
+    if (size < HEADER_SIZE)
+        return {};
+    bin->base = bin->file.map(0, size);
+    if (!bin->base)
+        return {};
+
+    const uchar *h = bin->base;
+    if (std::memcmp(h, MAGIC, 4) != 0 || qFromLittleEndian<quint16>(h + 4) != FORMAT_VERSION ||
+        qFromLittleEndian<quint16>(h + 6) != RECORD_SIZE)
+        return {};
+
+    const quint32 count = qFromLittleEndian<quint32>(h + 8);
+    const quint64 heapLen = qFromLittleEndian<quint64>(h + 24);
+    // 文件被截断时直接拒绝，不去读越界的内存
+    if (static_cast<quint64>(size) < HEADER_SIZE + quint64(count) * RECORD_SIZE + heapLen || count > INT_MAX)
+        return {};
+
+    bin->taskCount = static_cast<int>(count);
+    bin->fileGeneration = qFromLittleEndian<quint64>(h + 16);
+    bin->heap = h + HEADER_SIZE + qint64(count) * RECORD_SIZE;
+    bin->heapSize = static_cast<qint64>(heapLen);
+    return bin;
+}
+
+const uchar *TaskBinaryFile::record(int row) const {
+    return base + HEADER_SIZE + qint64(row) * RECORD_SIZE;
+}
+
+quint32 TaskBinaryFile::id(int row) const {
+    return qFromLittleEndian<quint32>(record(row) + 16);
+}
+
+quint64 TaskBinaryFile::rank(int row) const {
+    return qFromLittleEndian<quint64>(record(row) + 20);
+}
+
+bool TaskBinaryFile::done(int row) const {
+    return qFromLittleEndian<quint16>(record(row) + 12) & FLAG_DONE;
+}
+
+qint32 TaskBinaryFile::julianDay(int row) const {
+    const uchar *rec = record(row);
+    if (qFromLittleEndian<quint16>(rec + 12) & FLAG_RAW_DATE)
+        return 0;
+    return qFromLittleEndian<qint32>(rec);
+}
+
+QString TaskBinaryFile::title(int row) const {
+    const uchar *rec = record(row);
+    const qint64 offset = qFromLittleEndian<quint32>(rec + 4) + qFromLittleEndian<quint16>(rec + 14);
+    const qint64 len = qFromLittleEndian<quint32>(rec + 8);
+    if (offset + len > heapSize)
+        return QString();
+    return QString::fromUtf8(reinterpret_cast<const char *>(heap + offset), len);
+}
+
+QString TaskBinaryFile::date(int row) const {
+    const uchar *rec = record(row);
+    if (qFromLittleEndian<quint16>(rec + 12) & FLAG_RAW_DATE) {
+        const qint64 offset = qFromLittleEndian<quint32>(rec + 4);
+        const qint64 len = qFromLittleEndian<quint16>(rec + 14);
+        if (offset + len > heapSize)
+            return QString();
+        return QString::fromUtf8(reinterpret_cast<const char *>(heap + offset), len);
+    }
+    return TaskRecord::formatDay(qFromLittleEndian<qint32>(rec));
+}
+
+TaskTable TaskBinaryFile::table() const {
+    TaskTable tasks;
+    tasks.reserve(taskCount);
+    for (int row = 0; row < taskCount; ++row)
+        tasks.appendMapped(id(row), julianDay(row), done(row), rank(row), static_cast<quint32>(row));
+    return tasks;
+}
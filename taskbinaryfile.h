@@ -0,0 +1,52 @@
+#ifndef TASKBINARYFILE_H
+#define TASKBINARYFILE_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 紧凑二进制任务文件 (todo_data.ztdb) ---
+// 布局 (全部小端)：
+//   文件头 32 字节：  "ZTDB" | u16 版本 | u16 记录大小 | u32 任务数 | u32 保留 | u64 generation | u64 字符串堆大小
+//   定长记录表：      每条 28 字节  i32 儒略日 | u32 标题偏移 | u32 标题长度 | u16 标志 | u16 原样日期长度 | u32 编号
+//                                   | u64 顺序键
+//   字符串堆：        UTF-8 标题 (日期不是 yyyy-MM-dd 时，原样日期紧挨在标题前面)
+// 打开时整个文件 mmap 进来，只读记录表里的完成标志和儒略日；标题等滚动到那一行才解码。
+class TaskBinaryFile {
+  public:
+    ~TaskBinaryFile();
+
+    static bool isBinary(const QString &path); // 看文件头是不是 "ZTDB" (自动识别格式用)
+    static bool write(const QString &path, const TaskTable &tasks, quint64 generation);
+    // 打开并映射，文件不存在或格式不对时返回空指针
+    static QSharedPointer<TaskBinaryFile> open(const QString &path);
+
+    int count() const { return taskCount; }
+    quint64 generation() const { return fileGeneration; }
+
+    quint32 id(int row) const;
+    quint64 rank(int row) const;
+    bool done(int row) const;
+    qint32 julianDay(int row) const; // 没有合法日期时返回 0
+    QString title(int row) const;
+    QString date(int row) const;
+
+    // 全是映射行的任务表：只填编号、完成标志、儒略日和顺序键，不解码任何字符串，百万条也只是一次连续分配
+    TaskTable table() const;
+
+  private:
+    TaskBinaryFile() = default;
+    const uchar *record(int row) const;
+
+    QFile file;
+    const uchar *base = nullptr;
+    const uchar *heap = nullptr;
+    qint64 heapSize = 0;
+    int taskCount = 0;
+    quint64 fileGeneration = 0;
+};
+
+#endif // TASKBINARYFILE_H
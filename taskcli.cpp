@@ -0,0 +1,469 @@
+#include "taskcli.h"
+#include "taskjournal.h"
+#include "taskjsonwriter.h"
+#include "taskliststore.h"
+#include "taskmodel.h"
+#include "singleinstance.h"
+#include "syncengine.h"
+#include "syncserver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QSettings>
+#include <QStringMatcher>
+#include <QTextStream>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+// 每攒这么多条插一次模型 (一次 rowsInserted)
+const int INSERT_BATCH = 64 * 1024;
+// 标准输入一次读多少、标准输出攒多少再写 (字节)
+const qint64 INPUT_CHUNK_SIZE = 1024 * 1024;
+const qsizetype OUTPUT_CHUNK_SIZE = 1024 * 1024;
+
+enum Format { FormatText, FormatJsonl, FormatCsv, FormatJson };
+
+// 标准输出加一层大缓冲，别每行都进一次系统调用
+class Output {
+  public:
+    Output() {
+        file.open(stdout, QIODevice::WriteOnly);
+        buffer.reserve(OUTPUT_CHUNK_SIZE + 4096);
+    }
+    ~Output() { flush(); }
+
+    QByteArray &data() { return buffer; }
+    void lineDone() {
+        if (buffer.size() >= OUTPUT_CHUNK_SIZE)
+            flush();
+    }
+    void flush() {
+        if (!buffer.isEmpty())
+            file.write(buffer);
+        buffer.clear();
+        file.flush();
+    }
+
+  private:
+    QFile file;
+    QByteArray buffer;
+};
+
+// CSV 字段：含逗号、引号、换行时加引号，里面的引号双写
+void appendCsvField(QByteArray &out, const QString &text) {
+    const QByteArray utf8 = text.toUtf8();
+    if (utf8.contains(',') || utf8.contains('"') || utf8.contains('\n') || utf8.contains('\r')) {
+        out += '"';
+        for (char c : utf8) {
+            if (c == '"')
+                out += '"';
+            out += c;
+        }
+        out += '"';
+    } else {
+        out += utf8;
+    }
+}
+
+// 筛选条件：和界面上的搜索框、"已过期"一个意思
+struct Selection {
+    QStringMatcher matcher;
+    bool matching = false;
+    bool overdue = false;
+    int status = -1; // -1 全部，0 未完成，1 已完成
+    qint32 today = 0;
+
+    bool accepts(const TaskModel &model, int row) const {
+        const bool done = model.isDone(row);
+        if (status >= 0 && done != (status == 1))
+            return false;
+        // 已过期：有合法日期、早于今天、还没做完
+        const qint32 day = model.dueDay(row);
+        if (overdue && (done || day == 0 || day >= today))
+            return false;
+        if (matching && matcher.indexIn(model.title(row)) < 0 && matcher.indexIn(model.date(row)) < 0)
+            return false;
+        return true;
+    }
+};
+
+void writeTask(Output &out, const TaskModel &model, int row, Format format, bool first) {
+    QByteArray &buf = out.data();
+    const bool done = model.isDone(row);
+    switch (format) {
+    case FormatText:
+        buf += done ? "[x] " : "[ ] ";
+        buf += model.displayText(row).toUtf8();
+        buf += '\n';
+        break;
+    case FormatJsonl:
+        TaskJsonWriter::appendTask(buf, model.taskId(row), model.title(row), model.date(row), done);
+        buf += '\n';
+        break;
+    case FormatCsv:
+        buf += done ? "1," : "0,";
+        appendCsvField(buf, model.date(row));
+        buf += ',';
+        appendCsvField(buf, model.title(row));
+        buf += '\n';
+        break;
+    case FormatJson:
+        // 和旧版快照一样是纯数组，导出的文件可以直接当 todo_data.json 用
+        buf += first ? "[\n    " : ",\n    ";
+        TaskJsonWriter::appendTask(buf, model.taskId(row), model.title(row), model.date(row), done);
+        break;
+    }
+    out.lineDone();
+}
+
+// 逐块读标准输入，每行 "yyyy-MM-dd<TAB>标题" 或只有标题 (日期用 defaultDate)
+qint64 addFromStdin(TaskModel &model, const QString &defaultDate) {
+    QFile in;
+    if (!in.open(stdin, QIODevice::ReadOnly))
+        return 0;
+
+    QVector<TaskRecord> batch;
+    batch.reserve(INSERT_BATCH);
+    qint64 added = 0;
+    QByteArray pending; // 上一块末尾没读完的半行
+    auto addLine = [&](const char *begin, const char *end) {
+        if (end > begin && end[-1] == '\r')
+            --end;
+        if (end == begin)
+            return;
+        TaskRecord task;
+        const char *tab = static_cast<const char *>(memchr(begin, '\t', end - begin));
+        if (tab) {
+            const QString date = QString::fromUtf8(begin, tab - begin);
+            task.setDate(date.isEmpty() ? defaultDate : date);
+            task.title = QString::fromUtf8(tab + 1, end - tab - 1);
+        } else {
+            task.setDate(defaultDate);
+            task.title = QString::fromUtf8(begin, end - begin);
+        }
+        if (task.title.isEmpty())
+            return;
+        batch.append(task);
+        if (batch.size() >= INSERT_BATCH) {
+            model.appendTasks(batch);
+            added += batch.size();
+            batch.clear();
+        }
+    };
+
+    while (true) {
+        const QByteArray chunk = in.read(INPUT_CHUNK_SIZE);
+        if (chunk.isEmpty())
+            break;
+        pending += chunk;
+        const char *p = pending.constData();
+        const char *end = p + pending.size();
+        while (const char *nl = static_cast<const char *>(memchr(p, '\n', end - p))) {
+            addLine(p, nl);
+            p = nl + 1;
+        }
+        pending.remove(0, p - pending.constData());
+    }
+    addLine(pending.constData(), pending.constData() + pending.size());
+
+    model.appendTasks(batch);
+    return added + batch.size();
+}
+
+int usageError(const QCommandLineParser &parser, const QString &message) {
+    QTextStream(stderr) << "Z-Td: " << message << "\n\n" << parser.helpText();
+    return 1;
+}
+
+} // namespace
+
+int runTaskCli(int argc, char *argv[]) {
+#ifdef Q_OS_WIN
+    // 程序是 WIN32 子系统的，直接在命令行里跑时没有控制台：接到父进程的控制台上，输出才看得见。
+    // 已经被重定向到文件 / 管道时句柄本来就有效，不用管
+    if (!GetStdHandle(STD_OUTPUT_HANDLE) && AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("Z-Td");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Z-Td 命令行模式：不开窗口，批量查询和修改任务");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "add | list | export | done | undone | clear | stats | sync | serve");
+    parser.addPositionalArgument("titles", "add 的任务标题；写 - 表示从标准输入按行读取", "[标题...]");
+    const QCommandLineOption dataOption("data", "任务文件 (默认是当前清单的分片)", "file");
+    const QCommandLineOption listOption("list", "按名字选清单 (默认是界面上最后打开的那个)", "name");
+    const QCommandLineOption dateOption("date", "add 的截止日期 yyyy-MM-dd (默认今天)", "date");
+    const QCommandLineOption countOption("count", "add 时每个标题重复添加 N 条", "N", "1");
+    const QCommandLineOption matchOption("match", "只处理标题或日期里包含这段文字的任务 (不分大小写)", "text");
+    const QCommandLineOption overdueOption("overdue", "只处理已过期且未完成的任务");
+    const QCommandLineOption statusOption("status", "只处理 todo (未完成) 或 done (已完成) 的任务", "status");
+    const QCommandLineOption formatOption("format", "输出格式 text | jsonl | csv | json", "format");
+    const QCommandLineOption quietOption("quiet", "不在标准错误上打印统计");
+    const QCommandLineOption urlOption("url", "sync 用的同步服务器地址 (默认是设置里的 syncUrl)", "url");
+    const QCommandLineOption tokenOption("token", "同步服务器的口令 (sync 默认用设置里的 syncToken)", "token");
+    const QCommandLineOption bindOption("bind", "serve 监听的地址 (给别的机器用时写 0.0.0.0)", "address", "127.0.0.1");
+    const QCommandLineOption portOption("port", "serve 监听的端口", "port", QString::number(SyncProtocol::DEFAULT_PORT));
+    const QCommandLineOption storeOption("store", "serve 的数据文件 (默认是程序目录下的 ztd-sync-server.dat)", "file");
+    parser.addOptions({dataOption, listOption, dateOption, countOption, matchOption, overdueOption, statusOption, formatOption,
+                       quietOption, urlOption, tokenOption, bindOption, portOption, storeOption});
+
+    // 第一个参数 --cli 是 main() 用来选模式的，解析时去掉
+    QStringList arguments = app.arguments();
+    if (arguments.size() > 1 && arguments[1] == "--cli")
+        arguments.removeAt(1);
+    parser.process(arguments);
+
+    QStringList positional = parser.positionalArguments();
+    if (positional.isEmpty())
+        return usageError(parser, "缺少命令");
+    const QString command = positional.takeFirst();
+    const bool listing = command == "list" || command == "export";
+    const bool modifying = command == "add" || command == "done" || command == "undone" || command == "clear";
+    const bool stats = command == "stats";
+    const bool syncing = command == "sync";
+    if (!listing && !modifying && !stats && !syncing && command != "serve")
+        return usageError(parser, "不认识的命令 " + command);
+
+    // 参考同步服务器：不碰任务数据，一直跑到进程被关掉
+    if (command == "serve") {
+        bool portOk = false;
+        const int port = parser.value(portOption).toInt(&portOk);
+        if (!portOk || port < 0 || port > 65535)
+            return usageError(parser, "--port 必须是 0~65535");
+        const QHostAddress address(parser.value(bindOption));
+        if (address.isNull())
+            return usageError(parser, "--bind 不是合法的地址");
+        const QString store = parser.isSet(storeOption) ? parser.value(storeOption)
+                                                        : QCoreApplication::applicationDirPath() + "/ztd-sync-server.dat";
+        SyncServer server(store, parser.value(tokenOption));
+        if (!server.listen(address, static_cast<quint16>(port))) {
+            QTextStream(stderr) << "Z-Td: 无法监听 " << address.toString() << ":" << port << " (" << server.errorString()
+                                << ")\n";
+            return 1;
+        }
+        QTextStream(stderr) << "Z-Td: 同步服务器在 http://" << address.toString() << ":" << server.port()
+                            << " 上运行，数据存在 " << store << "\n";
+        return app.exec();
+    }
+
+    Format format = command == "export" ? FormatJson : FormatText;
+    if (parser.isSet(formatOption)) {
+        const QString name = parser.value(formatOption);
+        if (name == "text")
+            format = FormatText;
+        else if (name == "jsonl")
+            format = FormatJsonl;
+        else if (name == "csv")
+            format = FormatCsv;
+        else if (name == "json")
+            format = FormatJson;
+        else
+            return usageError(parser, "不认识的输出格式 " + name);
+    }
+
+    Selection selection;
+    selection.today = static_cast<qint32>(QDate::currentDate().toJulianDay());
+    selection.overdue = parser.isSet(overdueOption);
+    if (parser.isSet(matchOption)) {
+        selection.matcher = QStringMatcher(parser.value(matchOption), Qt::CaseInsensitive);
+        selection.matching = true;
+    }
+    if (parser.isSet(statusOption)) {
+        const QString status = parser.value(statusOption);
+        if (status != "todo" && status != "done")
+            return usageError(parser, "--status 只能是 todo 或 done");
+        selection.status = status == "done" ? 1 : 0;
+    }
+
+    bool countOk = false;
+    const int count = parser.value(countOption).toInt(&countOk);
+    if (!countOk || count < 1)
+        return usageError(parser, "--count 必须是正整数");
+    const QString defaultDate =
+        parser.isSet(dateOption) ? parser.value(dateOption) : QDate::currentDate().toString("yyyy-MM-dd");
+    if (command == "add" && positional.isEmpty())
+        return usageError(parser, "add 需要至少一个标题 (或 - 从标准输入读)");
+
+    // 界面开着的时候它手里也有一份任务，两边各写各的会互相覆盖。
+    // 加任务可以走 Z-Td --add 交给界面去加
+    if ((modifying || syncing) && !parser.isSet(dataOption) && SingleInstance::isRunning()) {
+        QTextStream(stderr) << "Z-Td: 界面正在运行，请先退出它再修改数据 (加任务可以用 Z-Td --add \"标题\")\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool quiet = parser.isSet(quietOption);
+    QTextStream err(stderr);
+
+    // 和界面同一套加载：快照 + 重放日志。二进制快照当场读完，JSON 要转几轮事件循环
+    QString path = parser.value(dataOption);
+    QString listName = parser.value(listOption);
+    if (path.isEmpty()) {
+        // 只读清单目录，不加载任何清单
+        TaskListStore lists(0, 1);
+        if (listName.isEmpty())
+            listName = lists.activeName();
+        path = lists.snapshotPath(listName);
+        if (path.isEmpty())
+            return usageError(parser, "没有叫 " + listName + " 的清单");
+    }
+    if (listName.isEmpty())
+        listName = QFileInfo(path).completeBaseName(); // 同步时服务器按清单名分开存
+    TaskModel model;
+    TaskJournal journal(path, 0);
+    bool loaded = false, failed = false;
+    QEventLoop loop;
+    QObject::connect(&journal, &TaskJournal::loaded, &loop, [&]() {
+        loaded = true;
+        loop.quit();
+    });
+    QObject::connect(&journal, &TaskJournal::loadFailed, &loop, [&]() {
+        failed = true;
+        loop.quit();
+    });
+    journal.load(&model);
+    if (!loaded && !failed)
+        loop.exec();
+    if (failed) {
+        err << "Z-Td: 任务文件损坏，读不出来 (原文件旁边留了一份 .bak)\n";
+        return 1;
+    }
+    if (!quiet)
+        err << "Z-Td: 读取 " << model.rowCount() << " 条任务 (" << timer.elapsed() << " ms)\n";
+
+    if (stats) {
+        // 条数 + 模型占的内存 (映射着的二进制快照先解码，量的是真正常驻的样子)
+        model.materialize();
+        model.rowForId(0);
+        qint64 done = 0, overdue = 0;
+        for (int row = 0; row < model.rowCount(); ++row) {
+            done += model.isDone(row);
+            overdue += !model.isDone(row) && model.dueDay(row) && model.dueDay(row) < selection.today;
+        }
+        const qsizetype bytes = model.memoryUsage();
+        QTextStream(stdout) << "tasks: " << model.rowCount() << "\ndone: " << done << "\noverdue: " << overdue
+                            << "\nmodel bytes: " << bytes << "\nbytes per task: "
+                            << (model.rowCount() ? QString::number(double(bytes) / model.rowCount(), 'f', 1) : "0")
+                            << "\n";
+        return 0;
+    }
+
+    if (syncing) {
+        QSettings settings("MySoft", "ToDoList");
+        const QString url = parser.isSet(urlOption) ? parser.value(urlOption) : settings.value("syncUrl").toString();
+        if (url.isEmpty())
+            return usageError(parser, "没有同步服务器地址：用 --url 指定，或者在设置里填 syncUrl");
+        // 收到的改动照常逐条记日志，中途断了已经收下的也不会丢
+        QNetworkAccessManager net;
+        SyncEngine engine(&net, QUrl(url));
+        engine.setToken(parser.isSet(tokenOption) ? parser.value(tokenOption) : settings.value("syncToken").toString());
+        QString error;
+        int sent = 0, received = 0;
+        QObject::connect(&engine, &SyncEngine::synced, &loop, [&](int s, int r) {
+            sent = s;
+            received = r;
+            loop.quit();
+        });
+        QObject::connect(&engine, &SyncEngine::syncFailed, &loop, [&](const QString &message) {
+            error = message;
+            loop.quit();
+        });
+        timer.restart();
+        engine.attach(&model, listName, SyncEngine::statePathFor(path));
+        loop.exec();
+        engine.detach();
+        if (received > 0)
+            journal.compact();
+        journal.flush();
+        if (!error.isEmpty()) {
+            err << "Z-Td: 同步失败：" << error << "\n";
+            return 1;
+        }
+        if (!quiet)
+            err << "Z-Td: sync 发出 " << sent << " 条，收下 " << received << " 条 (" << timer.elapsed() << " ms)\n";
+        return 0;
+    }
+
+    if (listing) {
+        timer.restart();
+        Output out;
+        if (format == FormatCsv)
+            out.data() += "done,date,title\n";
+        qint64 written = 0;
+        for (int row = 0; row < model.rowCount(); ++row) {
+            if (!selection.accepts(model, row))
+                continue;
+            writeTask(out, model, row, format, written == 0);
+            ++written;
+        }
+        if (format == FormatJson)
+            out.data() += written ? "\n]\n" : "[]\n";
+        out.flush();
+        if (!quiet)
+            err << "Z-Td: 输出 " << written << " 条 (" << timer.elapsed() << " ms)\n";
+        return 0;
+    }
+
+    // 批量修改不逐条记日志：改完写一份新快照 (日志随之清空)，比几百万行日志快得多
+    journal.setRecording(false);
+    timer.restart();
+    qint64 changed = 0;
+    if (command == "add") {
+        if (positional.size() == 1 && positional[0] == "-") {
+            changed = addFromStdin(model, defaultDate);
+        } else {
+            QVector<TaskRecord> batch;
+            for (const QString &title : positional) {
+                TaskRecord task;
+                task.title = title;
+                task.setDate(defaultDate);
+                for (int i = 0; i < count; ++i) {
+                    batch.append(task);
+                    if (batch.size() >= INSERT_BATCH) {
+                        model.appendTasks(batch);
+                        changed += batch.size();
+                        batch.clear();
+                    }
+                }
+            }
+            model.appendTasks(batch);
+            changed += batch.size();
+        }
+    } else if (command == "clear") {
+        // 和界面上的"清理已完成"一样，不看筛选条件
+        changed = model.removeDone();
+    } else {
+        const bool done = command == "done";
+        for (int row = 0; row < model.rowCount(); ++row) {
+            if (model.isDone(row) == done || !selection.accepts(model, row))
+                continue;
+            model.setDone(row, done);
+            ++changed;
+        }
+    }
+
+    if (changed > 0) {
+        journal.compact();
+        journal.flush();
+    }
+    if (!quiet)
+        err << "Z-Td: " << command << " " << changed << " 条 (" << timer.elapsed() << " ms)\n";
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef TASKCLI_H
+#define TASKCLI_H
+
+// --- 命令行模式 (Z-Td --cli <命令> ...) ---
+// 只起一个 QCoreApplication：不建窗口、不碰网络，读写和界面是同一套快照 + 日志代码。
+// 批量增删改时不逐条记日志，改完直接写一份新快照；输入输出都按块流式处理，
+// 百万条任务也只是读一遍、写一遍。
+//   add [标题...] [--date D] [--count N]   标题写 "-" 时从标准输入按行读 ("日期<TAB>标题" 或 "标题")
+//   list / export                          按条件列出任务 (--format text|jsonl|csv|json)
+//   done / undone / clear                  批量勾选、取消勾选、删除已完成
+//   stats                                  条数和每条任务占的内存
+// 筛选条件：--match 文字、--overdue、--status todo|done；--list 清单名 选择清单 (默认是当前清单)
+int runTaskCli(int argc, char *argv[]);
+
+#endif // TASKCLI_H
@@ -0,0 +1,85 @@
+#include "taskdateindex.h"
+#include "tracer.h"
+#include <algorithm>
+
+TaskDateIndex::TaskDateIndex(TaskModel *model, QObject *parent) : QObject(parent), model(model) {
+    connect(model, &TaskModel::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        if (built)
+            for (int row = first; row <= last; ++row)
+                addRow(row);
+    });
+    connect(model, &TaskModel::rowsAboutToBeRemoved, this, [this](const QModelIndex &, int first, int last) {
+        if (built)
+            for (int row = first; row <= last; ++row)
+                removeRow(row);
+    });
+    // 改截止日期：先按旧日期撤掉，改完再按新日期加回来
+    connect(model, &TaskModel::dateAboutToChange, this, [this](int row) {
+        if (built)
+            removeRow(row);
+    });
+    connect(model, &TaskModel::dataChanged, this,
+            [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+                if (built && roles.contains(TaskModel::DateRole))
+                    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+                        addRow(row);
+            });
+    connect(model, &TaskModel::modelReset, this, [this]() {
+        built = false;
+        entries.clear();
+    });
+}
+
+void TaskDateIndex::addRow(int row) {
+    const qint32 day = model->dueDay(row);
+    if (!day)
+        return;
+    const quint64 k = key(day, model->taskId(row));
+    if (entries.isEmpty() || entries.last() < k)
+        entries.append(k);
+    else
+        entries.insert(std::lower_bound(entries.begin(), entries.end(), k), k);
+}
+
+void TaskDateIndex::removeRow(int row) {
+    const qint32 day = model->dueDay(row);
+    if (!day)
+        return;
+    const quint64 k = key(day, model->taskId(row));
+    auto it = std::lower_bound(entries.begin(), entries.end(), k);
+    if (it != entries.end() && *it == k)
+        entries.erase(it);
+}
+
+void TaskDateIndex::ensureBuilt() {
+    if (built)
+        return;
+    // 日期早就是整数了，建索引只是收集一遍再排序
+    entries.clear();
+    entries.reserve(model->rowCount());
+    for (int row = 0; row < model->rowCount(); ++row) {
+        const qint32 day = model->dueDay(row);
+        if (day)
+            entries.append(key(day, model->taskId(row)));
+    }
+    std::sort(entries.begin(), entries.end());
+    built = true;
+}
+
+QVector<quint32> TaskDateIndex::query(qint32 fromDay, qint32 toDay) {
+    TraceSpan span("search.dateIndex");
+    QVector<quint32> ids;
+    if (fromDay < 1)
+        fromDay = 1;
+    if (toDay < fromDay)
+        return ids;
+    ensureBuilt();
+
+    auto first = std::lower_bound(entries.cbegin(), entries.cend(), key(fromDay, 0));
+    auto last = std::upper_bound(first, entries.cend(), key(toDay, 0xFFFFFFFFu));
+    ids.reserve(last - first);
+    for (auto it = first; it != last; ++it)
+        ids.append(static_cast<quint32>(*it));
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
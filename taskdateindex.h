@@ -0,0 +1,34 @@
+#ifndef TASKDATEINDEX_H
+#define TASKDATEINDEX_H
+
+#include <QObject>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 截止日期索引 ---
+// 一个按 (儒略日, 编号) 排好序的数组，插入删除用二分查找定位。
+// 按日期范围查询只要两次二分，再把命中的那一段拷出来，不用逐行解析日期字符串。
+// 跟 TaskSearchIndex 一样跟着模型信号增量更新，第一次查询前才整体建立。
+class TaskDateIndex : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit TaskDateIndex(TaskModel *model, QObject *parent = nullptr);
+
+    // 截止日期在 [fromDay, toDay] 之内的任务编号 (按编号升序)；没有合法日期的任务不参与
+    QVector<quint32> query(qint32 fromDay, qint32 toDay);
+
+  private:
+    static quint64 key(qint32 day, quint32 id) { return (quint64(quint32(day)) << 32) | id; }
+
+    void ensureBuilt();
+    void addRow(int row);
+    void removeRow(int row);
+
+    TaskModel *model;
+    bool built = false;
+    QVector<quint64> entries; // 高 32 位是儒略日，低 32 位是编号
+};
+
+#endif // TASKDATEINDEX_H
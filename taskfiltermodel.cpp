@@ -0,0 +1,238 @@
+#include "taskfiltermodel.h"
+#include <algorithm>
+
+TaskFilterModel::TaskFilterModel(QObject *parent) : QAbstractProxyModel(parent) {
+}
+
+void TaskFilterModel::setSourceModel(QAbstractItemModel *source) {
+    beginResetModel();
+    if (tasks)
+        disconnect(tasks, nullptr, this, nullptr);
+    QAbstractProxyModel::setSourceModel(source);
+    tasks = qobject_cast<TaskModel *>(source);
+    filtering = false;
+    ids.clear();
+    rows.clear();
+    proxyRowOf.clear();
+    endResetModel();
+    if (!tasks)
+        return;
+
+    // 不过滤时行号一一对应，信号原样转发，视图只动受影响的那几行；
+    // 过滤时命中的集合是定的 (新加的任务不在里面)，只有删掉命中的行才要通知视图，
+    // 别的增删只是换一下源行号，挪动按编号把选中项和当前项带到新位置。都不 reset，滚动位置和选中项不动
+    connect(tasks, &TaskModel::rowsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+        if (!filtering)
+            beginInsertRows(QModelIndex(), first, last);
+    });
+    connect(tasks, &TaskModel::rowsInserted, this, [this]() {
+        if (filtering)
+            remap();
+        else
+            endInsertRows();
+    });
+    connect(tasks, &TaskModel::rowsAboutToBeRemoved, this, [this](const QModelIndex &, int first, int last) {
+        if (filtering)
+            removeHits(first, last);
+        else
+            beginRemoveRows(QModelIndex(), first, last);
+    });
+    connect(tasks, &TaskModel::rowsRemoved, this, [this]() {
+        if (filtering)
+            remap();
+        else
+            endRemoveRows();
+    });
+    connect(tasks, &TaskModel::rowsAboutToBeMoved, this,
+            [this](const QModelIndex &, int first, int last, const QModelIndex &, int destination) {
+                if (filtering)
+                    beginLayoutChange();
+                else
+                    beginMoveRows(QModelIndex(), first, last, QModelIndex(), destination);
+            });
+    connect(tasks, &TaskModel::rowsMoved, this, [this]() {
+        if (filtering)
+            endLayoutChange();
+        else
+            endMoveRows();
+    });
+    // 源模型整表按键重排 (外部改动换了很多条的顺序)：同样按编号把索引带过去
+    connect(tasks, &TaskModel::layoutAboutToBeChanged, this, &TaskFilterModel::beginLayoutChange);
+    connect(tasks, &TaskModel::layoutChanged, this, &TaskFilterModel::endLayoutChange);
+    connect(tasks, &TaskModel::modelAboutToBeReset, this, &TaskFilterModel::beginSourceChange);
+    connect(tasks, &TaskModel::modelReset, this, &TaskFilterModel::endSourceChange);
+    connect(tasks, &TaskModel::dataChanged, this,
+            [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+                if (!filtering) {
+                    emit dataChanged(index(topLeft.row(), 0), index(bottomRight.row(), 0), roles);
+                    return;
+                }
+                for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+                    const QModelIndex idx = mapFromSource(tasks->index(row));
+                    if (idx.isValid())
+                        emit dataChanged(idx, idx, roles);
+                }
+            });
+}
+
+void TaskFilterModel::beginSourceChange() {
+    beginResetModel();
+}
+
+void TaskFilterModel::endSourceChange() {
+    if (filtering)
+        remap();
+    endResetModel();
+}
+
+// 删掉的源行里命中的那些从代理里拿掉 (源模型这时还没删，剩下的行号照旧)，连着的一段发一次
+void TaskFilterModel::removeHits(int first, int last) {
+    for (int end = rows.size() - 1; end >= 0;) {
+        if (rows[end] < first || rows[end] > last) {
+            --end;
+            continue;
+        }
+        int begin = end;
+        while (begin > 0 && rows[begin - 1] >= first && rows[begin - 1] <= last)
+            --begin;
+        beginRemoveRows(QModelIndex(), begin, end);
+        ids.remove(begin, end - begin + 1);
+        rows.remove(begin, end - begin + 1);
+        proxyRowOf.clear();
+        for (int i = 0; i < rows.size(); ++i)
+            proxyRowOf.insert(rows[i], i);
+        endRemoveRows();
+        end = begin - 1;
+    }
+}
+
+// 行换了位置：先按编号记下视图拿着的索引，挪完再放回各自任务的新位置
+void TaskFilterModel::beginLayoutChange() {
+    emit layoutAboutToBeChanged();
+    layoutIndexes = persistentIndexList();
+    layoutIds.resize(layoutIndexes.size());
+    for (int i = 0; i < layoutIndexes.size(); ++i)
+        layoutIds[i] = tasks->taskId(mapToSource(layoutIndexes[i]).row());
+}
+
+void TaskFilterModel::endLayoutChange() {
+    if (filtering)
+        remap();
+    QModelIndexList moved;
+    moved.reserve(layoutIds.size());
+    for (const quint32 id : std::as_const(layoutIds)) {
+        const int row = tasks->rowForId(id);
+        moved.append(row >= 0 ? mapFromSource(tasks->index(row)) : QModelIndex());
+    }
+    changePersistentIndexList(layoutIndexes, moved);
+    layoutIndexes.clear();
+    layoutIds.clear();
+    emit layoutChanged();
+}
+
+void TaskFilterModel::setFilter(const QVector<quint32> &newIds, Order newOrder) {
+    beginResetModel();
+    filtering = true;
+    order = newOrder;
+    ids = newIds;
+    remap();
+    endResetModel();
+}
+
+void TaskFilterModel::clearFilter() {
+    if (!filtering)
+        return;
+    beginResetModel();
+    filtering = false;
+    order = ListOrder;
+    ids.clear();
+    rows.clear();
+    proxyRowOf.clear();
+    endResetModel();
+}
+
+void TaskFilterModel::remap() {
+    QVector<QPair<int, quint32>> found;
+    found.reserve(ids.size());
+    for (quint32 id : std::as_const(ids)) {
+        const int row = tasks ? tasks->rowForId(id) : -1;
+        if (row >= 0)
+            found.append({row, id});
+    }
+    // 照给的顺序排的，源模型增删、挪动之后也不重排，只是换成新行号
+    if (order == ListOrder)
+        std::sort(found.begin(), found.end());
+
+    ids.resize(found.size());
+    rows.resize(found.size());
+    proxyRowOf.clear();
+    proxyRowOf.reserve(found.size());
+    for (int i = 0; i < found.size(); ++i) {
+        rows[i] = found[i].first;
+        ids[i] = found[i].second;
+        proxyRowOf.insert(rows[i], i);
+    }
+}
+
+QModelIndex TaskFilterModel::index(int row, int column, const QModelIndex &parent) const {
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount())
+        return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex TaskFilterModel::parent(const QModelIndex &) const {
+    return QModelIndex();
+}
+
+int TaskFilterModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid() || !tasks)
+        return 0;
+    return filtering ? rows.size() : tasks->rowCount();
+}
+
+int TaskFilterModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex TaskFilterModel::mapToSource(const QModelIndex &proxyIndex) const {
+    if (!proxyIndex.isValid() || !tasks)
+        return QModelIndex();
+    return tasks->index(filtering ? rows[proxyIndex.row()] : proxyIndex.row());
+}
+
+QModelIndex TaskFilterModel::mapFromSource(const QModelIndex &sourceIndex) const {
+    if (!sourceIndex.isValid())
+        return QModelIndex();
+    if (!filtering)
+        return index(sourceIndex.row(), 0);
+    auto it = proxyRowOf.constFind(sourceIndex.row());
+    return it == proxyRowOf.constEnd() ? QModelIndex() : index(it.value(), 0);
+}
+
+QVariant TaskFilterModel::data(const QModelIndex &index, int role) const {
+    if (role == Qt::ToolTipRole && dayToolTip && index.isValid()) {
+        const qint32 day = tasks->dueDay(mapToSource(index).row());
+        if (!day)
+            return QVariant();
+        const QString tip = dayToolTip(day);
+        return tip.isEmpty() ? QVariant() : QVariant(tip);
+    }
+    return QAbstractProxyModel::data(index, role);
+}
+
+Qt::ItemFlags TaskFilterModel::flags(const QModelIndex &index) const {
+    if (!tasks)
+        return Qt::NoItemFlags;
+    Qt::ItemFlags f = tasks->flags(mapToSource(index));
+    // 搜索结果只是列表的一部分，在里面拖动排序没有意义
+    if (filtering)
+        f &= ~(Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled);
+    return f;
+}
+
+bool TaskFilterModel::moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                               const QModelIndex &destinationParent, int destinationChild) {
+    if (filtering || !tasks || sourceParent.isValid() || destinationParent.isValid())
+        return false;
+    return tasks->moveRows(QModelIndex(), sourceRow, count, QModelIndex(), destinationChild);
+}
@@ -0,0 +1,65 @@
+#ifndef TASKFILTERMODEL_H
+#define TASKFILTERMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QHash>
+#include <QVector>
+#include <functional>
+
+#include "taskmodel.h"
+
+// --- 搜索结果的代理模型 ---
+// 夹在 TaskModel 和 QListView 之间。没有搜索时原样透传 (拖拽排序照常可用)；
+// 搜索时只暴露命中的那几行，一次 reset 换掉整个可见集合，
+// 不再逐行 setRowHidden 让视图一遍遍重新排版；之后源模型的增删挪只做增量通知，不再 reset。
+class TaskFilterModel : public QAbstractProxyModel {
+    Q_OBJECT
+
+  public:
+    explicit TaskFilterModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *source) override;
+
+    // 结果怎么排：按列表里的先后，还是照给的顺序 (模糊搜索按相关度排好了)
+    enum Order { ListOrder, GivenOrder };
+
+    // 只显示这些编号的任务；搜索期间不能拖动
+    void setFilter(const QVector<quint32> &ids, Order order = ListOrder);
+    void clearFilter();
+    bool isFiltering() const { return filtering; }
+
+    // 悬停提示 (比如截止日期那天的天气)：按任务的儒略日向外面要文字，返回空串就不提示
+    void setDayToolTipProvider(const std::function<QString(qint32 day)> &provider) { dayToolTip = provider; }
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count, const QModelIndex &destinationParent,
+                  int destinationChild) override;
+
+  private:
+    void remap(); // 源模型结构变了：按编号重新找行号，已经删掉的任务顺便剔除
+    void beginSourceChange();
+    void endSourceChange();
+    void removeHits(int first, int last); // 过滤时源模型要删 [first, last]
+    void beginLayoutChange();
+    void endLayoutChange();
+
+    TaskModel *tasks = nullptr;
+    bool filtering = false;
+    Order order = ListOrder;
+    QVector<quint32> ids;       // 命中的任务编号
+    QVector<int> rows;          // 对应的源行号 (ListOrder 时升序)
+    QHash<int, int> proxyRowOf; // 源行号 -> 代理行号
+    std::function<QString(qint32 day)> dayToolTip;
+    // 源模型挪动期间：视图拿着的索引和它们对应的任务编号
+    QModelIndexList layoutIndexes;
+    QVector<quint32> layoutIds;
+};
+
+#endif // TASKFILTERMODEL_H
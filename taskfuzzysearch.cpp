@@ -0,0 +1,370 @@
+#include "taskfuzzysearch.h"
+#include "tracer.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZTD_FUZZY_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define ZTD_FUZZY_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const int MAX_PATTERN = 64; // 关键词再长的部分不看
+const int MAX_NEEDLES = 16; // 预筛只查前 16 个不同的字
+
+// 打分 (都是小整数，最后平移到 [0, SCORE_RANGE) 做计数排序)
+const int SCORE_MATCH = 16;
+const int BONUS_CONSECUTIVE = 12; // 和前一个字紧挨着
+const int BONUS_BOUNDARY = 10;    // 落在词首 (标题开头、空格 / 标点之后)
+const int BONUS_EXACT = 24;       // 整个关键词原样连续出现
+const int PENALTY_GAP_START = 3;
+const int PENALTY_GAP_EXTEND = 1;
+const int PENALTY_TYPO = 30;
+const int SCORE_OFFSET = 2048;
+const int SCORE_RANGE = 4096;
+
+enum CharClass { Separator, Lower, Upper, Digit, Cjk };
+
+CharClass classOf(char16_t c) {
+    if (c < 0x80) {
+        if (c >= u'a' && c <= u'z')
+            return Lower;
+        if (c >= u'A' && c <= u'Z')
+            return Upper;
+        if (c >= u'0' && c <= u'9')
+            return Digit;
+        return Separator;
+    }
+    // 中文标点 (、。【】「」) 和全角标点
+    if ((c >= 0x3000 && c <= 0x303F) || (c >= 0xFF01 && c <= 0xFF0F) || (c >= 0xFF1A && c <= 0xFF20) ||
+        (c >= 0xFF3B && c <= 0xFF40) || (c >= 0xFF5B && c <= 0xFF65))
+        return Separator;
+    if ((c >= 0x2E80 && c < 0xA000) || (c >= 0xAC00 && c < 0xD7B0) || (c >= 0xF900 && c < 0xFB00))
+        return Cjk;
+    return QChar::isLetterOrNumber(c) ? Lower : Separator;
+}
+
+// 落在这个字上额外加多少分
+int boundaryBonus(CharClass previous, CharClass current) {
+    if (current == Separator)
+        return 0;
+    if (previous == Separator)
+        return BONUS_BOUNDARY;
+    if (previous == Lower && current == Upper)
+        return BONUS_BOUNDARY - 2; // camelCase
+    if ((previous == Cjk) != (current == Cjk) || (previous != Digit && current == Digit))
+        return BONUS_BOUNDARY - 4; // 中英文、字母数字交界
+    return 0;
+}
+
+char16_t foldChar(char16_t c) {
+    if (c < 0x80)
+        return c >= u'A' && c <= u'Z' ? static_cast<char16_t>(c + 32) : c;
+    if (c >= 0x2E80 && c < 0xFF00)
+        return c; // 中日韩文字没有大小写
+    return static_cast<char16_t>(QChar::toCaseFolded(char32_t(c)));
+}
+
+// 折叠后的关键词；每个字带上它的大写形式，标题原文不用折叠，两种写法都比一下就行
+struct Pattern {
+    char16_t lower[MAX_PATTERN];
+    char16_t upper[MAX_PATTERN];
+    int length = 0;
+    int maxTypos = 0;
+    int needle[MAX_PATTERN]; // 第几个字对应哪个预筛字 (-1 = 不在预筛里)
+    char16_t needleLower[MAX_NEEDLES];
+    char16_t needleUpper[MAX_NEEDLES];
+    int needleCount = 0;
+
+    explicit Pattern(const QString &text) {
+        for (const QChar ch : text) {
+            if (ch.isSpace() || length == MAX_PATTERN)
+                continue;
+            const char16_t c = foldChar(ch.unicode());
+            char16_t up = c;
+            if (c >= u'a' && c <= u'z')
+                up = static_cast<char16_t>(c - 32);
+            else if (c >= 0x80 && (c < 0x2E80 || c >= 0xFF00))
+                up = static_cast<char16_t>(QChar::toUpper(char32_t(c)));
+            lower[length] = c;
+            upper[length] = up;
+            needle[length] = -1;
+            for (int k = 0; k < needleCount; ++k)
+                if (needleLower[k] == c)
+                    needle[length] = k;
+            if (needle[length] < 0 && needleCount < MAX_NEEDLES) {
+                needleLower[needleCount] = c;
+                needleUpper[needleCount] = up;
+                needle[length] = needleCount++;
+            }
+            ++length;
+        }
+        // 一两个字打错了就是另一个词，不容错
+        maxTypos = length <= 2 ? 0 : length <= 5 ? 1 : 2;
+    }
+
+    QString folded() const { return QString(reinterpret_cast<const QChar *>(lower), length); }
+    bool matches(int j, char16_t c) const { return c == lower[j] || c == upper[j]; }
+};
+
+// --- 向量化的比较 ---
+// 每次读 8 个码元。标题在 arena 里是首尾相接的，读过标题结尾只要还没出 arena 就是安全的，
+// 多读进来的那几个码元用掩码去掉；离 arena 结尾不到 8 个码元时退回逐字比较。
+class Kernel {
+  public:
+    explicit Kernel(const Pattern &p) : p(p) {
+#if defined(ZTD_FUZZY_SSE2)
+        for (int j = 0; j < p.length; ++j) {
+            lo[j] = _mm_set1_epi16(static_cast<short>(p.lower[j]));
+            up[j] = _mm_set1_epi16(static_cast<short>(p.upper[j]));
+        }
+        for (int k = 0; k < p.needleCount; ++k) {
+            needleLo[k] = _mm_set1_epi16(static_cast<short>(p.needleLower[k]));
+            needleUp[k] = _mm_set1_epi16(static_cast<short>(p.needleUpper[k]));
+        }
+#elif defined(ZTD_FUZZY_NEON)
+        for (int j = 0; j < p.length; ++j) {
+            lo[j] = vdupq_n_u16(p.lower[j]);
+            up[j] = vdupq_n_u16(p.upper[j]);
+        }
+        for (int k = 0; k < p.needleCount; ++k) {
+            needleLo[k] = vdupq_n_u16(p.needleLower[k]);
+            needleUp[k] = vdupq_n_u16(p.needleUpper[k]);
+        }
+#endif
+    }
+
+    // 标题里出现了哪些预筛字 (按位)
+    quint32 present(const char16_t *s, qsizetype n, const char16_t *end) const {
+        const quint32 all = (1u << p.needleCount) - 1;
+        quint32 found = 0;
+        qsizetype i = 0;
+#if defined(ZTD_FUZZY_SSE2)
+        for (; i < n && s + i + 8 <= end; i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const int lanes = n - i >= 8 ? 0xFFFF : (1 << (2 * (n - i))) - 1;
+            for (int k = 0; k < p.needleCount; ++k) {
+                const __m128i eq = _mm_or_si128(_mm_cmpeq_epi16(v, needleLo[k]), _mm_cmpeq_epi16(v, needleUp[k]));
+                if (_mm_movemask_epi8(eq) & lanes)
+                    found |= 1u << k;
+            }
+            if (found == all)
+                return found;
+        }
+#elif defined(ZTD_FUZZY_NEON)
+        for (; i < n && s + i + 8 <= end; i += 8) {
+            const uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t *>(s + i));
+            const uint16x8_t lanes = laneMask(n - i);
+            for (int k = 0; k < p.needleCount; ++k) {
+                const uint16x8_t eq = vorrq_u16(vceqq_u16(v, needleLo[k]), vceqq_u16(v, needleUp[k]));
+                if (vmaxvq_u16(vandq_u16(eq, lanes)))
+                    found |= 1u << k;
+            }
+            if (found == all)
+                return found;
+        }
+#endif
+        for (; i < n; ++i)
+            for (int k = 0; k < p.needleCount; ++k)
+                if (s[i] == p.needleLower[k] || s[i] == p.needleUpper[k])
+                    found |= 1u << k;
+        return found;
+    }
+
+    // 从 from 开始找关键词第 j 个字，找不到返回 -1
+    qsizetype find(int j, const char16_t *s, qsizetype from, qsizetype n, const char16_t *end) const {
+        qsizetype i = from;
+#if defined(ZTD_FUZZY_SSE2)
+        for (; i < n && s + i + 8 <= end; i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i eq = _mm_or_si128(_mm_cmpeq_epi16(v, lo[j]), _mm_cmpeq_epi16(v, up[j]));
+            const int lanes = n - i >= 8 ? 0xFFFF : (1 << (2 * (n - i))) - 1;
+            const int mask = _mm_movemask_epi8(eq) & lanes;
+            if (mask)
+                return i + qCountTrailingZeroBits(static_cast<quint32>(mask)) / 2;
+        }
+#elif defined(ZTD_FUZZY_NEON)
+        for (; i < n && s + i + 8 <= end; i += 8) {
+            const uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t *>(s + i));
+            const uint16x8_t eq = vandq_u16(vorrq_u16(vceqq_u16(v, lo[j]), vceqq_u16(v, up[j])), laneMask(n - i));
+            // 每个码元收窄成一个字节，64 位里第一个非零字节就是第一个命中的位置
+            const quint64 mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(eq)), 0);
+            if (mask)
+                return i + qCountTrailingZeroBits(mask) / 8;
+        }
+#endif
+        for (; i < n; ++i)
+            if (p.matches(j, s[i]))
+                return i;
+        return -1;
+    }
+
+  private:
+#if defined(ZTD_FUZZY_NEON)
+    static uint16x8_t laneMask(qsizetype valid) {
+        static const uint16_t index[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        return vcltq_u16(vld1q_u16(index), vdupq_n_u16(static_cast<uint16_t>(std::min<qsizetype>(valid, 8))));
+    }
+#endif
+
+    const Pattern &p;
+#if defined(ZTD_FUZZY_SSE2)
+    __m128i lo[MAX_PATTERN], up[MAX_PATTERN];
+    __m128i needleLo[MAX_NEEDLES], needleUp[MAX_NEEDLES];
+#elif defined(ZTD_FUZZY_NEON)
+    uint16x8_t lo[MAX_PATTERN], up[MAX_PATTERN];
+    uint16x8_t needleLo[MAX_NEEDLES], needleUp[MAX_NEEDLES];
+#endif
+};
+
+// 给一条标题打分，不匹配返回 -1；s 后面到 end 之前的内容都可以读 (向量化用)
+int scoreTitle(const Pattern &p, const Kernel &kernel, const char16_t *s, qsizetype n, const char16_t *end) {
+    // 预筛：缺的字 (每缺一个至少错一个字) 超过容错数就不用往下看了
+    const quint32 found = kernel.present(s, n, end);
+    const int missing = p.needleCount - qPopulationCount(found);
+    if (missing > p.maxTypos)
+        return -1;
+
+    // 从前往后贪心地找每个字；找不到的算错字 (漏打、打错、多打都落在这里)
+    qsizetype pos[MAX_PATTERN];
+    int typos = 0;
+    int lastMatched = -1;
+    qsizetype from = 0;
+    for (int j = 0; j < p.length; ++j) {
+        const qsizetype k = (p.needle[j] >= 0 && !(found & (1u << p.needle[j]))) ? -1 : kernel.find(j, s, from, n, end);
+        if (k < 0) {
+            if (++typos > p.maxTypos)
+                return -1;
+            pos[j] = -1;
+            continue;
+        }
+        pos[j] = k;
+        from = k + 1;
+        lastMatched = j;
+    }
+    if (lastMatched < 0)
+        return -1;
+
+    // 再从最后一个字倒着往回找，让匹配尽量挤在一起 ("周一例会，周报" 里找 "周报" 取后面那对)
+    qsizetype k = pos[lastMatched];
+    for (int j = lastMatched - 1; j >= 0; --j) {
+        if (pos[j] < 0)
+            continue;
+        qsizetype q = k - 1;
+        while (q > pos[j] && !p.matches(j, s[q]))
+            --q;
+        pos[j] = q;
+        k = q;
+    }
+
+    int score = 0;
+    qsizetype previous = -2;
+    qsizetype first = -1;
+    bool contiguous = typos == 0;
+    for (int j = 0; j < p.length; ++j) {
+        const qsizetype q = pos[j];
+        if (q < 0) {
+            score -= PENALTY_TYPO;
+            continue;
+        }
+        if (first < 0)
+            first = q;
+        score += SCORE_MATCH;
+        if (q == previous + 1) {
+            score += BONUS_CONSECUTIVE;
+        } else if (previous >= 0) {
+            score -= PENALTY_GAP_START + std::min<int>(q - previous - 1, 20) * PENALTY_GAP_EXTEND;
+            contiguous = false;
+        }
+        score += boundaryBonus(q == 0 ? Separator : classOf(s[q - 1]), classOf(s[q]));
+        previous = q;
+    }
+    if (contiguous)
+        score += BONUS_EXACT + (n == p.length ? BONUS_BOUNDARY : 0); // 标题就是关键词本身
+    // 越靠前越好，越短越好 (都只是小幅调整)
+    score -= std::min<int>(first, 12);
+    score -= std::min<int>(n, 256) / 32;
+    return std::clamp(score + SCORE_OFFSET, 0, SCORE_RANGE - 1);
+}
+
+} // namespace
+
+TaskFuzzySearch::TaskFuzzySearch(TaskModel *model, QObject *parent) : QObject(parent), model(model) {
+    // 行号或标题一变，上一次的命中就不能接着用了
+    auto invalidate = [this]() { cacheValid = false; };
+    connect(model, &TaskModel::rowsInserted, this, invalidate);
+    connect(model, &TaskModel::rowsRemoved, this, invalidate);
+    connect(model, &TaskModel::rowsMoved, this, invalidate);
+    connect(model, &TaskModel::layoutChanged, this, invalidate);
+    connect(model, &TaskModel::modelReset, this, invalidate);
+    connect(model, &TaskModel::dataChanged, this,
+            [this](const QModelIndex &, const QModelIndex &, const QList<int> &roles) {
+                if (roles.contains(TaskModel::TitleRole))
+                    cacheValid = false;
+            });
+}
+
+int TaskFuzzySearch::score(QStringView title, const QString &text) {
+    const Pattern pattern(text);
+    if (!pattern.length)
+        return -1;
+    const Kernel kernel(pattern);
+    const char16_t *s = reinterpret_cast<const char16_t *>(title.utf16());
+    return scoreTitle(pattern, kernel, s, title.size(), s + title.size());
+}
+
+QVector<quint32> TaskFuzzySearch::search(const QString &text) {
+    TraceSpan span("search.fuzzy");
+    const Pattern pattern(text);
+    if (!pattern.length)
+        return {};
+    const Kernel kernel(pattern);
+
+    // 映射着的二进制快照先整体解码进 arena (搜索索引建立时本来也要把每条标题读一遍)
+    model->materialize();
+    const TaskTable &table = model->table();
+    const QStringView arena = table.titleArena();
+    const char16_t *base = reinterpret_cast<const char16_t *>(arena.utf16());
+    const char16_t *end = base + arena.size();
+
+    // 接着上一次的关键词往后打字：多打的字只会让命中变少 (贪心匹配的前一段完全一样)，只在上次的命中里找
+    const QString folded = pattern.folded();
+    const bool narrowing = cacheValid && pattern.maxTypos == lastMaxTypos && folded.startsWith(lastPattern);
+    const int candidates = narrowing ? lastRows.size() : table.size();
+
+    // 分数都在 [0, SCORE_RANGE) 里：按分数计数排序，同分的自然保持列表顺序
+    QVector<int> hitRows;
+    QVector<quint16> hitScores;
+    QVector<int> counts(SCORE_RANGE, 0);
+    for (int i = 0; i < candidates; ++i) {
+        const int row = narrowing ? lastRows[i] : i;
+        const TaskRow &r = table.row(row);
+        const int score = scoreTitle(pattern, kernel, base + r.offset, r.length, end);
+        if (score < 0)
+            continue;
+        hitRows.append(row);
+        hitScores.append(static_cast<quint16>(score));
+        ++counts[score];
+    }
+
+    // 高分在前：每个分数段的起点
+    int start = 0;
+    for (int score = SCORE_RANGE - 1; score >= 0; --score) {
+        const int count = counts[score];
+        counts[score] = start;
+        start += count;
+    }
+    QVector<quint32> ids(hitRows.size());
+    for (int i = 0; i < hitRows.size(); ++i)
+        ids[counts[hitScores[i]]++] = table.row(hitRows[i]).id;
+
+    cacheValid = true;
+    lastPattern = folded;
+    lastMaxTypos = pattern.maxTypos;
+    lastRows = std::move(hitRows);
+    return ids;
+}
@@ -0,0 +1,40 @@
+#ifndef TASKFUZZYSEARCH_H
+#define TASKFUZZYSEARCH_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 模糊搜索：按相关度排序 ---
+// 关键词的字按顺序出现在标题里就算命中 (中间可以隔着别的字)，打错、漏打几个字也能容忍
+// (3~5 个字容忍 1 个，6 个以上容忍 2 个)。每条命中按 连续程度 / 词首 / 间隔 / 错字 打分，分高的在前。
+// 标题都在 TaskTable 的 arena 里首尾相接，直接在上面扫：
+// * 先用 SIMD (x86 SSE2 / ARM NEON，其余平台退回逐字) 一次比 8 个 UTF-16 码元，
+//   缺的字超过容错数的标题直接跳过；
+// * 打分时找下一个字也是同一套向量比较，再倒着收紧一遍让匹配尽量挤在一起；
+// * 中文没有大小写、也没有空格分词，所以连续命中的加分最重，"周报" 连着出现比 "周…报" 排得靠前；
+// * 接着上一次的关键词往后打字时只在上一次的命中里找，不用重扫整张表。
+class TaskFuzzySearch : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit TaskFuzzySearch(TaskModel *model, QObject *parent = nullptr);
+
+    // 返回标题模糊匹配 text 的任务编号，相关度高的在前，同分的按列表顺序；text 为空时返回空表
+    QVector<quint32> search(const QString &text);
+
+    // 单条打分 (基准和调试用)：不匹配返回 -1，越大越相关
+    static int score(QStringView title, const QString &text);
+
+  private:
+    TaskModel *model;
+    // 上一次的结果，继续打字时在这里面找；模型一变就作废
+    bool cacheValid = false;
+    QString lastPattern; // 折叠、去掉空白后的关键词
+    int lastMaxTypos = 0;
+    QVector<int> lastRows; // 命中的行号 (升序)
+};
+
+#endif // TASKFUZZYSEARCH_H
@@ -0,0 +1,147 @@
+#include "taskitemdelegate.h"
+#include "taskmodel.h"
+#include "themeengine.h"
+#include <QApplication>
+#include <QDate>
+#include <QPainter>
+#include <QtMath>
+
+// 缓存几屏的行就够了，再多只是占内存
+const int CACHE_ROWS = 2048;
+// 复选框、徽标、标题之间的间距，徽标内边距和圆角
+const int GAP = 8;
+const int BADGE_HPAD = 6;
+const int BADGE_VPAD = 2;
+const qreal BADGE_RADIUS = 4;
+// 已过期且没做完的任务，日期徽标换成红色
+const QColor OVERDUE_COLOR("#d9534f");
+
+TaskItemDelegate::TaskItemDelegate(ThemeEngine *theme, QObject *parent)
+    : QStyledItemDelegate(parent), theme(theme), cache(CACHE_ROWS) {
+}
+
+void TaskItemDelegate::watchModel(QAbstractItemModel *newModel) {
+    if (model)
+        disconnect(model, nullptr, this, nullptr);
+    model = newModel;
+    cache.clear();
+    if (!model)
+        return;
+    connect(model, &QAbstractItemModel::dataChanged, this,
+            [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+                    cache.remove(model->index(row, 0).data(TaskModel::IdRole).toUInt());
+            });
+    // 编号只在同一个清单里唯一，换了源模型 (reset) 就整个作废
+    connect(model, &QAbstractItemModel::modelReset, this, &TaskItemDelegate::clearCache);
+}
+
+void TaskItemDelegate::clearCache() {
+    cache.clear();
+}
+
+TaskItemDelegate::RowLayout *TaskItemDelegate::layoutFor(const QModelIndex &index, const QFont &font,
+                                                         int width) const {
+    if (font != cachedFont) {
+        cache.clear();
+        cachedFont = font;
+    }
+
+    const quint32 id = index.data(TaskModel::IdRole).toUInt();
+    RowLayout *row = cache.object(id);
+    if (!row) {
+        row = new RowLayout;
+        const QString date = index.data(TaskModel::DateRole).toString();
+        row->day = TaskRecord::parseDay(date);
+        row->done = index.data(Qt::CheckStateRole).toInt() == Qt::Checked;
+        row->fullTitle = index.data(TaskModel::TitleRole).toString();
+        if (!date.isEmpty()) {
+            row->date.setText(date);
+            row->date.setTextFormat(Qt::PlainText);
+            row->date.prepare(QTransform(), font);
+            row->dateWidth = qCeil(row->date.size().width());
+        }
+        cache.insert(id, row);
+    }
+
+    // 宽度变了 (拖动窗口) 才重新省略标题
+    if (row->availableWidth != width) {
+        row->availableWidth = width;
+        QFont titleFont(font);
+        titleFont.setStrikeOut(row->done);
+        const int badge = row->dateWidth ? row->dateWidth + 2 * BADGE_HPAD + GAP : 0;
+        const QString elided =
+            QFontMetrics(titleFont).elidedText(row->fullTitle, Qt::ElideRight, std::max(0, width - badge));
+        row->title.setText(elided);
+        row->title.setTextFormat(Qt::PlainText);
+        row->title.prepare(QTransform(), titleFont);
+    }
+    return row;
+}
+
+void TaskItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    // 不调 initStyleOption：它每次都会把 "[日期] 标题" 重新拼一遍
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    QStyleOptionViewItem opt(option);
+    opt.features |= QStyleOptionViewItem::HasCheckIndicator;
+    opt.checkState = static_cast<Qt::CheckState>(index.data(Qt::CheckStateRole).toInt());
+
+    // 背景 (选中 / 悬停 / 分隔线) 还是交给 ThemeEngine 的样式
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter, widget);
+
+    // 复选框位置和 QStyledItemDelegate::editorEvent 算的一致，点击勾选照常工作
+    QStyleOptionViewItem checkOpt(opt);
+    checkOpt.rect = style->subElementRect(QStyle::SE_ItemViewItemCheckIndicator, &opt, widget);
+    checkOpt.state &= ~QStyle::State_HasFocus;
+    checkOpt.state |= opt.checkState == Qt::Checked ? QStyle::State_On : QStyle::State_Off;
+    style->drawPrimitive(QStyle::PE_IndicatorItemViewItemCheck, &checkOpt, painter, widget);
+
+    int x = checkOpt.rect.right() + 1 + GAP;
+    const int width = opt.rect.right() - GAP - x;
+    if (width <= 0)
+        return;
+    const RowLayout *row = layoutFor(index, opt.font, width);
+
+    const QFontMetrics fm(opt.font);
+    const int textTop = opt.rect.top() + (opt.rect.height() - fm.height()) / 2;
+    const bool selected = opt.state & QStyle::State_Selected;
+    painter->save();
+    painter->setFont(opt.font);
+
+    if (row->dateWidth) {
+        const qint32 today = static_cast<qint32>(QDate::currentDate().toJulianDay());
+        const bool overdue = !row->done && row->day && row->day < today;
+        const QColor accent = theme ? theme->current().accent : opt.palette.color(QPalette::Link);
+        const QColor color = overdue ? OVERDUE_COLOR : accent;
+        QColor fill(color);
+        fill.setAlpha(selected ? 64 : 36);
+
+        const QRect badge(x, textTop - BADGE_VPAD, row->dateWidth + 2 * BADGE_HPAD, fm.height() + 2 * BADGE_VPAD);
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(fill);
+        painter->drawRoundedRect(badge, BADGE_RADIUS, BADGE_RADIUS);
+        painter->setPen(color);
+        painter->drawStaticText(badge.left() + BADGE_HPAD, textTop, row->date);
+        x = badge.right() + 1 + GAP;
+    }
+
+    QFont titleFont(opt.font);
+    titleFont.setStrikeOut(row->done);
+    painter->setFont(titleFont);
+    // 做完的灰掉并划线；选中时用选中文字色
+    QPalette::ColorRole role = QPalette::Text;
+    if (row->done)
+        role = QPalette::PlaceholderText;
+    else if (selected)
+        role = QPalette::HighlightedText;
+    painter->setPen(opt.palette.color(role));
+    painter->drawStaticText(x, textTop, row->title);
+    painter->restore();
+}
+
+QSize TaskItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    // 行高沿用原来的 (样式里加过上下内边距)；视图设了 uniformItemSizes，只会问一次
+    return QStyledItemDelegate::sizeHint(option, index);
+}
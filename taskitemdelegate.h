@@ -0,0 +1,48 @@
+#ifndef TASKITEMDELEGATE_H
+#define TASKITEMDELEGATE_H
+
+#include <QCache>
+#include <QFont>
+#include <QPointer>
+#include <QStaticText>
+#include <QStyledItemDelegate>
+
+class ThemeEngine;
+
+// --- 任务行委托 ---
+// 直接画 复选框 + 日期徽标 + 标题，不再让 QStyledItemDelegate 每次绘制都重新排一遍 "[日期] 标题"。
+// 每行的文字排版 (QStaticText，标题已按宽度省略) 按任务编号缓存，
+// 只有这一行被改过、列宽 / 字体变了、或者切换主题时才重新排；滚动时只是把缓存好的字形贴上去。
+class TaskItemDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+  public:
+    TaskItemDelegate(ThemeEngine *theme, QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // 跟着视图的模型走：行被改动时丢掉那几行的缓存，模型 reset (搜索、切换清单) 时全部丢掉
+    void watchModel(QAbstractItemModel *model);
+    void clearCache(); // 切换主题 / 窗口藏起来时调用
+
+  private:
+    struct RowLayout {
+        QStaticText date;
+        QStaticText title;
+        QString fullTitle;       // 没省略的标题，宽度变了要重新省略
+        qint32 day = 0;          // 日期解析成的儒略日，判断是否过期用
+        int availableWidth = -1; // 标题按这个宽度 (含日期徽标) 省略过
+        int dateWidth = 0;
+        bool done = false;
+    };
+
+    RowLayout *layoutFor(const QModelIndex &index, const QFont &font, int width) const;
+
+    QPointer<ThemeEngine> theme;
+    QPointer<QAbstractItemModel> model;
+    mutable QCache<quint32, RowLayout> cache; // 编号 -> 排版；只需要装得下几屏
+    mutable QFont cachedFont;                 // 缓存里的排版是按这个字体做的
+};
+
+#endif // TASKITEMDELEGATE_H
@@ -0,0 +1,740 @@
+#include "taskjournal.h"
+#include "persistworker.h"
+#include "taskbinaryfile.h"
+#include "taskjsonreader.h"
+#include "taskjsonwriter.h"
+#include "taskmerge.h"
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSettings>
+#include <algorithm>
+
+// 日志至少攒这么多条才压缩；列表越长阈值越高，保证压缩的摊还开销是 O(1)
+const qint64 MIN_COMPACT_OPS = 1000;
+// 达到阈值后等用户停手这么久再压缩 (毫秒)
+const int COMPACT_IDLE_MS = 3000;
+// 流式加载：每次从文件读多少字节，每轮事件循环最多解析多久 (毫秒)
+const qint64 LOAD_CHUNK_SIZE = 256 * 1024;
+const int LOAD_SLICE_MS = 8;
+const qint64 PEEK_CHUNK_SIZE = 4096;
+// 流式写 JSON 快照：缓冲区攒到这么大就写一次
+const qsizetype SAVE_CHUNK_SIZE = 1024 * 1024;
+// 快照文件变了以后等这么久再去读 (毫秒)：别的程序往往分几次写完，也等自己的写盘回执先到
+const int WATCH_SETTLE_MS = 300;
+
+TaskJournal::TaskJournal(const QString &snapshotPath, int coalesceMs, QObject *parent)
+    : QObject(parent), snapshotPath(snapshotPath) {
+    QFileInfo info(snapshotPath);
+    logPath = info.absolutePath() + "/" + info.completeBaseName() + ".journal";
+
+    QString altPath = alternatePath(snapshotPath);
+
+    compactTimer = new QTimer(this);
+    compactTimer->setSingleShot(true);
+    compactTimer->setInterval(COMPACT_IDLE_MS);
+    connect(compactTimer, &QTimer::timeout, this, &TaskJournal::compact);
+
+    // 磁盘 I/O 全部交给独立线程
+    workerThread = new QThread(this);
+    worker = new PersistWorker(snapshotPath, altPath, logPath, coalesceMs);
+    worker->moveToThread(workerThread);
+    // 自己写的快照落盘后记下它的样子，之后文件变了才分得清是谁改的
+    connect(worker, &PersistWorker::snapshotWritten, this, [this](quint64 gen, qint64 size, qint64 modifiedMs) {
+        if (gen == generation)
+            rememberDiskFile(size, modifiedMs);
+    });
+    workerThread->start();
+}
+
+TaskJournal::~TaskJournal() {
+    flush();
+    workerThread->quit();
+    workerThread->wait();
+    delete worker;
+}
+
+QString TaskJournal::defaultSnapshotPath(const QString &baseName) {
+    // 改用 json 后缀；设置里 storageFormat=binary 时用二进制格式，启动时按文件头自动识别。
+    // 存储格式是用户在设置里选的，界面、命令行模式和各个清单的分片都从这里拿路径
+    QSettings settings("MySoft", "ToDoList");
+    const bool binary = settings.value("storageFormat", "json").toString() == "binary";
+    return QCoreApplication::applicationDirPath() + "/" + baseName + (binary ? ".ztdb" : ".json");
+}
+
+bool TaskJournal::isBinaryPath(const QString &path) {
+    return path.endsWith(".ztdb", Qt::CaseInsensitive);
+}
+
+QString TaskJournal::alternatePath(const QString &path) {
+    QFileInfo info(path);
+    QString base = info.absolutePath() + "/" + info.completeBaseName();
+    return base + (isBinaryPath(path) ? ".json" : ".ztdb");
+}
+
+// --- 快照：读 (按文件头自动识别 JSON / 二进制) ---
+bool TaskJournal::readSnapshot(const QString &path, TaskTable &tasks, quint64 &generation,
+                               QSharedPointer<TaskBinaryFile> *mapped) {
+    tasks = TaskTable();
+    generation = 0;
+
+    if (TaskBinaryFile::isBinary(path)) {
+        QSharedPointer<TaskBinaryFile> bin = TaskBinaryFile::open(path);
+        if (!bin)
+            return false;
+        generation = bin->generation();
+        tasks = bin->table();
+        if (mapped) {
+            // 字符串留在映射里，等界面滚到那一行再解码
+            *mapped = bin;
+        } else {
+            tasks.materialize(*bin);
+        }
+        return true;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // 流式解析，不建 DOM；旧版纯数组和新版带 generation 的对象都认识。
+    // 每块解析出来的记录马上搬进紧凑表，不留一整份 QVector<TaskRecord>
+    TaskJsonReader reader;
+    QVector<TaskRecord> batch;
+    while (!reader.atEnd() && !reader.hasError()) {
+        if (file.atEnd())
+            reader.finish();
+        else
+            reader.addData(file.read(LOAD_CHUNK_SIZE));
+        batch.clear();
+        reader.readTasks(batch);
+        for (const TaskRecord &task : std::as_const(batch))
+            tasks.append(task);
+    }
+    generation = reader.generation();
+    return !reader.hasError();
+}
+
+// 只读到任务数组开头为止，偷看快照的 generation (二进制直接看文件头)
+bool TaskJournal::peekGeneration(const QString &path, quint64 &generation) {
+    generation = 0;
+    if (TaskBinaryFile::isBinary(path)) {
+        QSharedPointer<TaskBinaryFile> bin = TaskBinaryFile::open(path);
+        if (bin)
+            generation = bin->generation();
+        return !bin.isNull();
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    TaskJsonReader reader;
+    QVector<TaskRecord> ignored;
+    while (!reader.reachedTasks() && !reader.atEnd() && !reader.hasError() && !file.atEnd()) {
+        reader.addData(file.read(PEEK_CHUNK_SIZE));
+        reader.readTasks(ignored, 0);
+    }
+    generation = reader.generation();
+    return true;
+}
+
+// --- 快照：写 (QSaveFile 先写临时文件再改名，写到一半崩溃也不会坏) ---
+bool TaskJournal::writeSnapshot(const QString &path, const TaskTable &tasks, quint64 generation) {
+    if (isBinaryPath(path))
+        return TaskBinaryFile::write(path, tasks, generation);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    // 不建 QJsonDocument：边序列化边写，内存里最多只有一块缓冲
+    QByteArray chunk;
+    chunk.reserve(SAVE_CHUNK_SIZE + 4096);
+    chunk += "{\n    \"generation\": " + QByteArray::number(generation) + ",\n    \"tasks\": [";
+    for (int i = 0; i < tasks.size(); ++i) {
+        chunk += i ? ",\n        " : "\n        ";
+        TaskJsonWriter::appendTask(chunk, tasks.row(i).id, tasks.title(i), tasks.dateText(i), tasks.isDone(i),
+                                   tasks.rank(i));
+        if (chunk.size() >= SAVE_CHUNK_SIZE) {
+            if (file.write(chunk) != chunk.size())
+                return false;
+            chunk.clear();
+        }
+    }
+    chunk += tasks.isEmpty() ? "]\n}\n" : "\n    ]\n}\n";
+    if (file.write(chunk) != chunk.size())
+        return false;
+    return file.commit();
+}
+
+// --- JSON <-> 二进制 互相转换，generation 原样保留 ---
+bool TaskJournal::convertSnapshot(const QString &fromPath, const QString &toPath) {
+    TaskTable tasks;
+    quint64 gen = 0;
+    if (!readSnapshot(fromPath, tasks, gen))
+        return false;
+    return writeSnapshot(toPath, tasks, gen);
+}
+
+// 日志里 [first, first + count) 的顺序键 (十六进制字符串数组)；没记的话什么也不做
+static bool applyRanks(TaskModel *target, int first, const QJsonArray &array, int count) {
+    if (array.isEmpty())
+        return true;
+    if (array.size() != count || first < 0 || first + count > target->rowCount())
+        return false;
+    QVector<quint64> ranks(count);
+    for (int i = 0; i < count; ++i) {
+        ranks[i] = TaskRecord::parseRank(array[i].toString());
+        if (!ranks[i])
+            return false;
+    }
+    target->setRanks(first, ranks);
+    return true;
+}
+
+// --- 重放一条日志操作 (直接作用在模型上) ---
+bool TaskJournal::applyOp(TaskModel *target, const QJsonObject &op) {
+    const QString type = op["op"].toString();
+    const int size = target->rowCount();
+
+    if (type == "add") {
+        int row = op["row"].toInt(-1);
+        if (row < 0 || row > size)
+            return false;
+        TaskRecord task;
+        task.id = static_cast<quint32>(op["id"].toDouble());
+        task.title = op["title"].toString();
+        task.setDate(op["date"].toString());
+        task.done = op["done"].toBool();
+        task.rank = TaskRecord::parseRank(op["rank"].toString());
+        target->insertTask(row, task);
+        return true;
+    }
+    if (type == "toggle") {
+        int row = op["row"].toInt(-1);
+        if (row < 0 || row >= size)
+            return false;
+        target->setDone(row, op["done"].toBool());
+        return true;
+    }
+    if (type == "edit") {
+        int row = op["row"].toInt(-1);
+        if (row < 0 || row >= size)
+            return false;
+        target->setTitle(row, op["title"].toString());
+        return true;
+    }
+    if (type == "date") {
+        int row = op["row"].toInt(-1);
+        if (row < 0 || row >= size)
+            return false;
+        target->setDate(row, op["date"].toString());
+        return true;
+    }
+    if (type == "del") {
+        int row = op["row"].toInt(-1);
+        int count = op["count"].toInt(1);
+        return target->removeRows(row, count);
+    }
+    if (type == "move") {
+        // 语义同 QAbstractItemModel::moveRows：把 [from, from+count) 挪到 to 之前
+        int from = op["from"].toInt(-1);
+        int count = op["count"].toInt(1);
+        int to = op["to"].toInt(-1);
+        if (from < 0 || count <= 0 || from + count > size || to < 0 || to > size)
+            return false;
+        // 挪回原位是合法的空操作
+        if (to >= from && to <= from + count)
+            return true;
+        if (!target->moveRows(QModelIndex(), from, count, QModelIndex(), to))
+            return false;
+        // 记下来的新顺序键照搬 (旧日志没有，就用 moveRows 自己取的)
+        return applyRanks(target, to < from ? to : to - count, op["ranks"].toArray(), count);
+    }
+    if (type == "rank") {
+        // 附近一段被重新拉开了
+        const QJsonArray ranks = op["ranks"].toArray();
+        return applyRanks(target, op["row"].toInt(-1), ranks, ranks.size());
+    }
+    if (type == "clear") {
+        target->removeDone();
+        return true;
+    }
+    if (type == "reorder") {
+        // 按编号换顺序键，换完整表按键排
+        const QJsonArray ids = op["ids"].toArray();
+        const QJsonArray ranks = op["ranks"].toArray();
+        if (ids.size() != ranks.size())
+            return false;
+        QVector<QPair<quint32, quint64>> pairs;
+        pairs.reserve(ids.size());
+        for (int i = 0; i < ids.size(); ++i) {
+            const quint64 rank = TaskRecord::parseRank(ranks[i].toString());
+            if (!rank)
+                return false;
+            pairs.append({static_cast<quint32>(ids[i].toDouble()), rank});
+        }
+        target->applyRanks(pairs);
+        return true;
+    }
+    return false;
+}
+
+bool TaskJournal::readJournalHeader(const QString &path, quint64 &generation) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray header = file.readLine();
+    QJsonObject headerObj = QJsonDocument::fromJson(header).object();
+    generation = static_cast<quint64>(headerObj["generation"].toDouble());
+    return header.endsWith('\n') && headerObj.contains("generation");
+}
+
+// 日志头记着它接在哪一代快照后面，用它在 json / ztdb 两份快照里挑出对得上的那份
+QString TaskJournal::chooseSnapshot(bool &converting) const {
+    converting = false;
+    quint64 journalGeneration = 0;
+    bool hasJournal = readJournalHeader(logPath, journalGeneration);
+
+    quint64 gen = 0;
+    bool found = peekGeneration(snapshotPath, gen);
+    if (found && (!hasJournal || gen == journalGeneration))
+        return snapshotPath;
+
+    // 用户切换了存储格式：另一种格式的快照才是最新的，先读它，稍后按当前格式重写
+    QString altPath = alternatePath(snapshotPath);
+    quint64 altGeneration = 0;
+    if (peekGeneration(altPath, altGeneration) && (!found || altGeneration == journalGeneration)) {
+        converting = true;
+        return altPath;
+    }
+    return snapshotPath;
+}
+
+void TaskJournal::load(TaskModel *target) {
+    loadStarted = Tracer::isEnabled() ? Tracer::now() : -1;
+    loadTarget = target;
+    opsSinceSnapshot = 0;
+    QString path = chooseSnapshot(loadConverting);
+
+    if (TaskBinaryFile::isBinary(path)) {
+        // 二进制：映射一下就好，字符串等滚到那一行再解码
+        TaskTable tasks;
+        QSharedPointer<TaskBinaryFile> mapped;
+        if (!readSnapshot(path, tasks, generation, &mapped)) {
+            // 文件头对、内容坏了 (截断、损坏)：不能当成空表往下走，不然日志被重开、下次压缩拿空表盖掉原文件。
+            // 原文件留一份备份，日志不动，模型只读，也不挂上日志 (不记操作、不压缩)
+            qWarning() << "Z-Td: task file is damaged, cannot load" << path;
+            QFile::remove(path + ".bak");
+            QFile::copy(path, path + ".bak");
+            target->setTasks({});
+            target->setReadOnly(true);
+            emit loadFailed();
+            return;
+        }
+        target->setTable(tasks, mapped);
+        finishLoad();
+        return;
+    }
+
+    // JSON：分块流式解析，每轮事件循环只干一小会儿，第一屏任务马上就能画出来。
+    // 加载期间模型只读，免得用户的改动和还没读完的行号对不上
+    target->setTasks({});
+    target->setReadOnly(true);
+    loadReader = TaskJsonReader();
+    loadFile.setFileName(path);
+    if (!loadFile.open(QIODevice::ReadOnly)) {
+        generation = 0;
+        finishLoad();
+        return;
+    }
+    loadStep();
+}
+
+void TaskJournal::loadStep() {
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<TaskRecord> batch;
+    while (!loadReader.atEnd() && !loadReader.hasError() && timer.elapsed() < LOAD_SLICE_MS) {
+        if (loadFile.atEnd())
+            loadReader.finish();
+        else
+            loadReader.addData(loadFile.read(LOAD_CHUNK_SIZE));
+        loadReader.readTasks(batch);
+    }
+    // 这一轮读到的任务一次性插进模型，只发一次 rowsInserted
+    if (!batch.isEmpty())
+        loadTarget->appendTasks(batch);
+
+    if (!loadReader.atEnd() && !loadReader.hasError()) {
+        // 让出事件循环 (先去画界面)，下一轮接着读
+        QMetaObject::invokeMethod(this, &TaskJournal::loadStep, Qt::QueuedConnection);
+        return;
+    }
+
+    if (loadReader.hasError()) {
+        // 文件坏了：能读的都读出来了，原文件留一份备份，免得之后被压缩覆盖掉
+        qWarning() << "Z-Td: task file is damaged, loaded" << loadTarget->rowCount() << "tasks";
+        QFile::remove(loadFile.fileName() + ".bak");
+        QFile::copy(loadFile.fileName(), loadFile.fileName() + ".bak");
+    }
+    loadFile.close();
+    generation = loadReader.generation();
+    loadReader = TaskJsonReader(); // 释放缓冲区
+    loadTarget->setReadOnly(false);
+    finishLoad();
+}
+
+void TaskJournal::finishLoad() {
+    QFile file(logPath);
+    bool replayed = false;
+    if (file.open(QIODevice::ReadWrite)) {
+        // 第一行是日志头，代数和快照一致才说明这些操作还没进快照
+        QByteArray header = file.readLine();
+        QJsonObject headerObj = QJsonDocument::fromJson(header).object();
+        if (header.endsWith('\n') && headerObj.contains("generation") &&
+            static_cast<quint64>(headerObj["generation"].toDouble()) == generation) {
+            qint64 goodEnd = file.pos();
+            while (!file.atEnd()) {
+                QByteArray line = file.readLine();
+                // 没有换行结尾 = 写到一半就崩了，丢掉这半行
+                if (!line.endsWith('\n'))
+                    break;
+                QJsonObject op = QJsonDocument::fromJson(line).object();
+                if (!applyOp(loadTarget, op))
+                    break;
+                goodEnd = file.pos();
+                ++opsSinceSnapshot;
+            }
+            // 截掉坏掉的尾巴，后面追加的行才不会粘在半行后面
+            if (goodEnd < file.size())
+                file.resize(goodEnd);
+            replayed = true;
+        }
+        file.close();
+    }
+
+    // 日志不存在 / 已经过期 (上次压缩在改名之间崩溃)，重新开一份
+    // 这时工作线程还没开始写，可以直接在这里同步处理
+    if (!replayed)
+        writeJournalHeader(logPath, generation);
+
+    // 加载完再挂上，之后的每次改动都只追加一行日志
+    attach(loadTarget);
+    // 旧文件没有任务编号 (或者编号被换过)：尽快写一份带编号的快照，文件被外部改了才对得上号
+    if (loadConverting || opsSinceSnapshot > MIN_COMPACT_OPS || loadTarget->takeIdsReassigned())
+        compactTimer->start();
+    if (watcher) {
+        resetBase();
+        const QFileInfo info(snapshotPath);
+        rememberDiskFile(info.size(), info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1);
+        watchSnapshot();
+    }
+    // 流式加载跨了好几轮事件循环，从 load() 算到这里
+    if (loadStarted >= 0)
+        Tracer::record("journal.load", loadStarted, Tracer::now());
+    emit loaded();
+}
+
+void TaskJournal::attach(TaskModel *taskModel) {
+    model = taskModel;
+    connect(model, &QAbstractItemModel::rowsInserted, this, &TaskJournal::onRowsInserted);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, &TaskJournal::onRowsRemoved);
+    connect(model, &QAbstractItemModel::rowsMoved, this, &TaskJournal::onRowsMoved);
+    connect(model, &QAbstractItemModel::dataChanged, this, &TaskJournal::onDataChanged);
+    connect(model, &TaskModel::ranksApplied, this, &TaskJournal::onRanksApplied);
+    connect(model, &TaskModel::doneAboutToBeCleared, this, &TaskJournal::onDoneAboutToBeCleared);
+    // 整体替换没法用单条操作描述，直接写新快照 (合并外部改动完本来就会写一份；清理已完成记成了一行 clear)
+    connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+        if (std::exchange(clearingDone, false) || merging)
+            return;
+        compact();
+    });
+}
+
+void TaskJournal::compact() {
+    if (!model)
+        return;
+    TraceSpan span("journal.compact");
+    compactTimer->stop();
+
+    // 快照之前的日志行先投递出去，保证工作线程看到的顺序和界面一致
+    postPending();
+
+    // 映射的二进制文件马上要被新快照替换 (Windows 下映射着的文件不能改名覆盖)，先全部解码出来
+    model->materialize();
+
+    // 代数 +1；任务表隐式共享，这里只是加个引用计数，真正的序列化在工作线程
+    generation += 1;
+    opsSinceSnapshot = 0;
+    // 这份快照一写下去，磁盘上就是现在的样子了
+    if (watcher)
+        resetBase();
+    TaskTable tasks = model->table();
+    quint64 gen = generation;
+    QMetaObject::invokeMethod(worker, [this, tasks, gen]() { worker->requestSnapshot(tasks, gen); },
+                              Qt::QueuedConnection);
+}
+
+void TaskJournal::flush() {
+    postPending();
+    QMetaObject::invokeMethod(worker, [this]() { worker->flush(); }, Qt::BlockingQueuedConnection);
+}
+
+bool TaskJournal::writeJournalHeader(const QString &path, quint64 newGeneration) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QJsonObject header;
+    header["generation"] = static_cast<double>(newGeneration);
+    file.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+    return file.commit();
+}
+
+void TaskJournal::append(const QJsonObject &op) {
+    // 界面线程上每次改动都走这里 (序列化 + 投递)；真正写盘的是 persist.write
+    TraceSpan span("journal.append");
+    // 一行一个操作；同一轮事件循环里的连续改动 (比如清理已完成) 合成一次投递
+    pendingLines += QJsonDocument(op).toJson(QJsonDocument::Compact) + '\n';
+    if (!postScheduled) {
+        postScheduled = true;
+        QMetaObject::invokeMethod(this, &TaskJournal::postPending, Qt::QueuedConnection);
+    }
+
+    ++opsSinceSnapshot;
+    qint64 threshold = std::max<qint64>(MIN_COMPACT_OPS, model->rowCount() / 2);
+    if (opsSinceSnapshot > threshold && !compactTimer->isActive())
+        compactTimer->start();
+}
+
+void TaskJournal::postPending() {
+    postScheduled = false;
+    if (pendingLines.isEmpty())
+        return;
+    QByteArray lines;
+    lines.swap(pendingLines);
+    QMetaObject::invokeMethod(worker, [this, lines]() { worker->appendLines(lines); }, Qt::QueuedConnection);
+}
+
+void TaskJournal::onRowsInserted(const QModelIndex &, int first, int last) {
+    if (!recording)
+        return;
+    for (int row = first; row <= last; ++row) {
+        QJsonObject op;
+        op["op"] = "add";
+        op["row"] = row;
+        op["id"] = static_cast<double>(model->taskId(row));
+        op["title"] = model->title(row);
+        op["date"] = model->date(row);
+        op["done"] = model->isDone(row);
+        op["rank"] = TaskRecord::formatRank(model->rank(row));
+        append(op);
+    }
+}
+
+void TaskJournal::onRowsRemoved(const QModelIndex &, int first, int last) {
+    if (!recording)
+        return;
+    QJsonObject op;
+    op["op"] = "del";
+    op["row"] = first;
+    op["count"] = last - first + 1;
+    append(op);
+}
+
+void TaskJournal::onRowsMoved(const QModelIndex &, int start, int end, const QModelIndex &, int row) {
+    // 挪过的几条现在在 [first, first + count)；它们的顺序键是新的，别的行都没变
+    const int count = end - start + 1;
+    const int first = row < start ? row : row - count;
+    if (watcher && !merging) {
+        for (int i = first; i < first + count; ++i)
+            dirty[model->taskId(i)] |= TaskMerge::OrderField;
+    }
+
+    if (!recording)
+        return;
+    QJsonObject op;
+    op["op"] = "move";
+    op["from"] = start;
+    op["count"] = count;
+    op["to"] = row;
+    QJsonArray ranks;
+    for (int i = first; i < first + count; ++i)
+        ranks.append(TaskRecord::formatRank(model->rank(i)));
+    op["ranks"] = ranks;
+    append(op);
+}
+
+// 清理已完成的段数太多，模型整表压缩一遍 (之后是 reset)：日志只记一行，重放时再压缩一遍
+void TaskJournal::onDoneAboutToBeCleared() {
+    clearingDone = true;
+    if (!recording)
+        return;
+    QJsonObject op;
+    op["op"] = "clear";
+    append(op);
+}
+
+// 外部改动一次换了很多条的顺序键、整表重排过：按编号记成一行，重放时照样整表排一次
+void TaskJournal::onRanksApplied(const QVector<QPair<quint32, quint64>> &ranks) {
+    if (watcher && !merging) {
+        for (const auto &entry : ranks)
+            dirty[entry.first] |= TaskMerge::OrderField;
+    }
+
+    if (!recording)
+        return;
+    QJsonObject op;
+    op["op"] = "reorder";
+    QJsonArray ids, keys;
+    for (const auto &entry : ranks) {
+        ids.append(static_cast<double>(entry.first));
+        keys.append(TaskRecord::formatRank(entry.second));
+    }
+    op["ids"] = ids;
+    op["ranks"] = keys;
+    append(op);
+}
+
+void TaskJournal::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+    const bool toggled = roles.isEmpty() || roles.contains(Qt::CheckStateRole);
+    const bool edited = roles.isEmpty() || roles.contains(TaskModel::TitleRole);
+    const bool dated = roles.isEmpty() || roles.contains(TaskModel::DateRole);
+    const bool ranked = roles.isEmpty() || roles.contains(TaskModel::RankRole);
+
+    // 记下本地改过哪些字段，文件被外部改了时这些字段留本地的 (合并本身的改动不算)
+    if (watcher && !merging) {
+        const quint8 fields = (edited ? TaskMerge::TitleField : 0) | (dated ? TaskMerge::DateField : 0) |
+                              (toggled ? TaskMerge::DoneField : 0) | (ranked ? TaskMerge::OrderField : 0);
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+            dirty[model->taskId(row)] |= fields;
+    }
+
+    if (!recording)
+        return;
+    if (ranked) {
+        // 重新拉开的一整段记成一行
+        QJsonObject op;
+        op["op"] = "rank";
+        op["row"] = topLeft.row();
+        QJsonArray ranks;
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+            ranks.append(TaskRecord::formatRank(model->rank(row)));
+        op["ranks"] = ranks;
+        append(op);
+    }
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        if (toggled) {
+            QJsonObject op;
+            op["op"] = "toggle";
+            op["row"] = row;
+            op["done"] = model->isDone(row);
+            append(op);
+        }
+        if (edited) {
+            QJsonObject op;
+            op["op"] = "edit";
+            op["row"] = row;
+            op["title"] = model->title(row);
+            append(op);
+        }
+        if (dated) {
+            QJsonObject op;
+            op["op"] = "date";
+            op["row"] = row;
+            op["date"] = model->date(row);
+            append(op);
+        }
+    }
+}
+
+// --- 监视快照文件 ---
+void TaskJournal::setWatching(bool on) {
+    if (on == (watcher != nullptr))
+        return;
+    if (!on) {
+        delete watcher;
+        watcher = nullptr;
+        baseIds.clear();
+        dirty.clear();
+        return;
+    }
+    watcher = new QFileSystemWatcher(this);
+    settleTimer = new QTimer(watcher);
+    settleTimer->setSingleShot(true);
+    settleTimer->setInterval(WATCH_SETTLE_MS);
+    connect(settleTimer, &QTimer::timeout, this, &TaskJournal::checkDiskFile);
+    connect(watcher, &QFileSystemWatcher::fileChanged, settleTimer, qOverload<>(&QTimer::start));
+    // 原子替换 (先写临时文件再改名) 之后原来的监视就失效了，所以连目录一起看着
+    connect(watcher, &QFileSystemWatcher::directoryChanged, settleTimer, qOverload<>(&QTimer::start));
+    // 已经加载好了就从现在开始对比，否则等加载完
+    if (model) {
+        resetBase();
+        const QFileInfo info(snapshotPath);
+        rememberDiskFile(info.size(), info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1);
+        watchSnapshot();
+    }
+}
+
+void TaskJournal::watchSnapshot() {
+    const QString dir = QFileInfo(snapshotPath).absolutePath();
+    if (!watcher->directories().contains(dir))
+        watcher->addPath(dir);
+    if (!watcher->files().contains(snapshotPath) && QFile::exists(snapshotPath))
+        watcher->addPath(snapshotPath);
+}
+
+void TaskJournal::rememberDiskFile(qint64 size, qint64 modifiedMs) {
+    diskSize = size;
+    diskModified = modifiedMs;
+}
+
+void TaskJournal::resetBase() {
+    // 现在内存里的每个编号记一位，改动记录清空
+    quint32 maxId = 0;
+    for (int row = 0; row < model->rowCount(); ++row)
+        maxId = std::max(maxId, model->taskId(row));
+    baseIds = QBitArray(int(maxId) + 1);
+    for (int row = 0; row < model->rowCount(); ++row)
+        baseIds.setBit(int(model->taskId(row)));
+    dirty.clear();
+}
+
+void TaskJournal::checkDiskFile() {
+    if (!watcher || !model)
+        return;
+    watchSnapshot();
+    const QFileInfo info(snapshotPath);
+    // 被删了不跟着删 (下次写快照时会重新建出来)；大小和修改时间都和自己写的一样就是自己写的
+    if (!info.exists() || (info.size() == diskSize && info.lastModified().toMSecsSinceEpoch() == diskModified))
+        return;
+
+    TaskTable theirs;
+    quint64 theirGeneration = 0;
+    if (!readSnapshot(snapshotPath, theirs, theirGeneration)) {
+        // 多半是对方还没写完 (不是原子替换的工具)，写完还会再通知一次
+        qWarning() << "Z-Td: cannot read changed task file yet" << snapshotPath;
+        return;
+    }
+    rememberDiskFile(info.size(), info.lastModified().toMSecsSinceEpoch());
+
+    // 合并出来的改动不逐条记日志：合并完直接写一份新快照 (代数接在两边较大的后面)，日志也跟着换新
+    postPending();
+    const bool wasRecording = recording;
+    recording = false;
+    merging = true;
+    const int changed = TaskMerge::merge(model, theirs, baseIds, dirty);
+    merging = false;
+    recording = wasRecording;
+    generation = std::max(generation, theirGeneration);
+    compact();
+    emit externalChangesMerged(changed);
+}
@@ -0,0 +1,127 @@
+#ifndef TASKJOURNAL_H
+#define TASKJOURNAL_H
+
+#include <QBitArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include "taskjsonreader.h"
+#include "taskmodel.h"
+
+class PersistWorker;
+class QFileSystemWatcher;
+class TaskBinaryFile;
+
+// --- 追加式日志持久化 ---
+// 磁盘上是两份文件：
+//   todo_data.json     快照 {"generation": N, "tasks": [...]} (兼容旧版的纯数组)
+//                      或 todo_data.ztdb 二进制快照 (见 TaskBinaryFile)，打开时按文件头自动识别
+//   todo_data.journal  第一行是 {"generation": N}，之后每行一个操作 (add/toggle/edit/date/move/rank/reorder/del/clear)
+// 每次改动只往日志末尾追加一行，写入量和列表长度无关 (拖动排序也一样：只记挪了哪几行和它们的新顺序键)；
+// 日志攒到一定量后在空闲时压缩成新快照。快照和日志都用 QSaveFile 原子替换，
+// 中途崩溃最多丢掉写了一半的最后一行，不会弄坏整个文件。
+// 真正的写盘交给 PersistWorker 线程，界面线程只负责把操作序列化后投递过去。
+class TaskJournal : public QObject {
+    Q_OBJECT
+
+  public:
+    // coalesceMs：合并写入的时间窗口，窗口内的连续改动只写一次盘
+    TaskJournal(const QString &snapshotPath, int coalesceMs, QObject *parent = nullptr);
+    ~TaskJournal();
+
+    // 读快照并重放日志。JSON 快照分多轮事件循环流式读入，读完后发出 loaded()，
+    // 并自动 attach 到模型上；二进制快照在这里当场完成 (坏了的话发 loadFailed()，模型保持只读、不挂日志)
+    void load(TaskModel *target);
+    // 之后模型的每一次增删改移都追加成一行日志
+    void attach(TaskModel *model);
+    // 把当前模型整体写成新快照，并清空日志 (在工作线程里写)
+    void compact();
+    // 同步等待工作线程把手上的数据全部写完 (只在退出时用)
+    void flush();
+
+    // 关掉后模型的改动不再逐条记日志 (命令行批量改动用)，改完自己 compact() 一次
+    void setRecording(bool on) { recording = on; }
+
+    // 盯着快照文件：别的程序 (同步盘、脚本) 改了它，就按任务编号把改动合并进模型，
+    // 只动变了的行，然后写一份合并后的新快照 (见 TaskMerge)
+    void setWatching(bool on);
+
+    QString journalPath() const { return logPath; }
+
+    // 按设置里的 storageFormat 选出程序目录下的快照文件 (baseName 不带后缀，可以带子目录)
+    static QString defaultSnapshotPath(const QString &baseName = QStringLiteral("todo_data"));
+
+    static bool isBinaryPath(const QString &path);     // 后缀 .ztdb = 二进制格式
+    static QString alternatePath(const QString &path); // todo_data.json <-> todo_data.ztdb
+    // mapped 为空时二进制快照会被完整解码；否则字符串留在映射里懒加载
+    static bool readSnapshot(const QString &path, TaskTable &tasks, quint64 &generation,
+                             QSharedPointer<TaskBinaryFile> *mapped = nullptr);
+    static bool peekGeneration(const QString &path, quint64 &generation);
+    static bool readJournalHeader(const QString &path, quint64 &generation);
+    static bool writeSnapshot(const QString &path, const TaskTable &tasks, quint64 generation);
+    static bool writeJournalHeader(const QString &path, quint64 generation);
+    static bool convertSnapshot(const QString &fromPath, const QString &toPath); // 无损互转
+    // 把一条日志操作应用到模型上，格式不对时返回 false
+    static bool applyOp(TaskModel *target, const QJsonObject &op);
+
+  signals:
+    void loaded(); // 快照和日志都读完了，可以开始编辑
+    void loadFailed(); // 二进制快照坏了，原文件已备份成 .bak，什么都不写
+    void externalChangesMerged(int changedRows); // 文件被外部改过，已经合并进模型
+
+  private:
+    void append(const QJsonObject &op);
+    void postPending();
+    QString chooseSnapshot(bool &converting) const;
+    void loadStep();
+    void finishLoad();
+    void watchSnapshot();
+    void rememberDiskFile(qint64 size, qint64 modifiedMs);
+    void resetBase();
+    void checkDiskFile();
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+    void onRanksApplied(const QVector<QPair<quint32, quint64>> &ranks);
+    void onDoneAboutToBeCleared();
+
+    QString snapshotPath;
+    QString logPath;
+    TaskModel *model = nullptr;
+    quint64 generation = 0;   // 当前快照的代数，日志头里要和它一致才会被重放
+    qint64 opsSinceSnapshot = 0;
+    QTimer *compactTimer;     // 空闲时压缩日志
+
+    QThread *workerThread;
+    PersistWorker *worker;
+    QByteArray pendingLines;  // 同一轮事件循环里攒下的日志行，一次性投递给工作线程
+    bool postScheduled = false;
+    bool recording = true;
+
+    // 流式加载的进度
+    TaskModel *loadTarget = nullptr;
+    bool loadConverting = false;
+    QFile loadFile;
+    TaskJsonReader loadReader;
+    qint64 loadStarted = -1; // 跟踪用，没开跟踪时是 -1
+
+    // 监视快照文件 (没打开时 watcher 为空)
+    QFileSystemWatcher *watcher = nullptr;
+    QTimer *settleTimer = nullptr;
+    qint64 diskSize = -1;      // 最近一次自己读 / 写的快照文件的大小和修改时间
+    qint64 diskModified = -1;
+    QBitArray baseIds;         // 那时候有哪些任务编号
+    QHash<quint32, quint8> dirty; // 那之后本地改过的任务 → 改过的字段 (TaskMerge::Field)
+    bool merging = false;
+    bool clearingDone = false; // 接下来那次 reset 是清理已完成，已经记成 clear 了
+};
+
+#endif // TASKJOURNAL_H
@@ -0,0 +1,391 @@
+#include "taskjsonreader.h"
+#include <cstring>
+
+namespace {
+
+enum ParseResult { ParseOk, ParseNeedMore, ParseFail };
+
+void skipWhitespace(const char *&p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        ++p;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// 解析一个字符串 (p 指向开头的引号)；out 为空时只跳过。
+// UTF-8 的多字节字符里不会出现 '"' 和 '\\'，所以可以直接按字节扫描。
+ParseResult parseString(const char *&p, const char *end, QString *out) {
+    const char *q = p + 1;
+    const char *segment = q;
+    QString result;
+    while (true) {
+        if (q >= end)
+            return ParseNeedMore;
+        const char c = *q;
+        if (c == '"')
+            break;
+        if (c != '\\') {
+            ++q;
+            continue;
+        }
+
+        // 转义：先把前面一段原样收下
+        if (out)
+            result += QString::fromUtf8(segment, q - segment);
+        if (q + 1 >= end)
+            return ParseNeedMore;
+        const char e = q[1];
+        if (e == 'u') {
+            if (end - q < 6)
+                return ParseNeedMore;
+            int code = 0;
+            for (int i = 2; i < 6; ++i) {
+                int h = hexValue(q[i]);
+                if (h < 0)
+                    return ParseFail;
+                code = code * 16 + h;
+            }
+            // 代理对会被拆成两个 \u 转义，各自按一个 UTF-16 码元追加即可
+            if (out)
+                result += QChar(static_cast<char16_t>(code));
+            q += 6;
+        } else {
+            char ch;
+            switch (e) {
+            case '"': ch = '"'; break;
+            case '\\': ch = '\\'; break;
+            case '/': ch = '/'; break;
+            case 'b': ch = '\b'; break;
+            case 'f': ch = '\f'; break;
+            case 'n': ch = '\n'; break;
+            case 'r': ch = '\r'; break;
+            case 't': ch = '\t'; break;
+            default: return ParseFail;
+            }
+            if (out)
+                result += QLatin1Char(ch);
+            q += 2;
+        }
+        segment = q;
+    }
+
+    if (out) {
+        if (segment == p + 1) {
+            // 常见情况：没有任何转义，一次解码
+            *out = QString::fromUtf8(segment, q - segment);
+        } else {
+            result += QString::fromUtf8(segment, q - segment);
+            *out = result;
+        }
+    }
+    p = q + 1;
+    return ParseOk;
+}
+
+// 读出对象的键但不解码 (键里没有转义，直接按字节比较)
+ParseResult parseKey(const char *&p, const char *end, const char *&key, int &keyLength) {
+    const char *q = p + 1;
+    while (q < end && *q != '"' && *q != '\\')
+        ++q;
+    if (q >= end)
+        return ParseNeedMore;
+    if (*q == '\\') {
+        // 带转义的键肯定不是我们关心的，按普通字符串跳过
+        key = nullptr;
+        keyLength = 0;
+        return parseString(p, end, nullptr);
+    }
+    key = p + 1;
+    keyLength = static_cast<int>(q - key);
+    p = q + 1;
+    return ParseOk;
+}
+
+bool keyIs(const char *key, int keyLength, const char *name) {
+    return key && keyLength == static_cast<int>(std::strlen(name)) && std::memcmp(key, name, keyLength) == 0;
+}
+
+ParseResult parseLiteral(const char *&p, const char *end, const char *word) {
+    const qsizetype len = static_cast<qsizetype>(std::strlen(word));
+    if (end - p < len)
+        return std::memcmp(p, word, end - p) == 0 ? ParseNeedMore : ParseFail;
+    if (std::memcmp(p, word, len) != 0)
+        return ParseFail;
+    p += len;
+    return ParseOk;
+}
+
+bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// 数字一直读到分隔符为止；数据到头了还没看到分隔符，说明可能被分块截断了
+ParseResult parseNumber(const char *&p, const char *end, quint64 *out) {
+    const char *q = p;
+    quint64 value = 0;
+    while (q < end && *q >= '0' && *q <= '9') {
+        value = value * 10 + static_cast<quint64>(*q - '0');
+        ++q;
+    }
+    while (q < end && isNumberChar(*q))
+        ++q;
+    if (q >= end)
+        return ParseNeedMore;
+    if (q == p)
+        return ParseFail;
+    if (out)
+        *out = value;
+    p = q;
+    return ParseOk;
+}
+
+ParseResult skipValue(const char *&p, const char *end, int depth = 0) {
+    if (depth > 64)
+        return ParseFail;
+    skipWhitespace(p, end);
+    if (p >= end)
+        return ParseNeedMore;
+
+    switch (*p) {
+    case '"':
+        return parseString(p, end, nullptr);
+    case 't':
+        return parseLiteral(p, end, "true");
+    case 'f':
+        return parseLiteral(p, end, "false");
+    case 'n':
+        return parseLiteral(p, end, "null");
+    case '{':
+    case '[': {
+        const bool isObject = *p == '{';
+        const char close = isObject ? '}' : ']';
+        ++p;
+        while (true) {
+            skipWhitespace(p, end);
+            if (p >= end)
+                return ParseNeedMore;
+            if (*p == close) {
+                ++p;
+                return ParseOk;
+            }
+            if (*p == ',') {
+                ++p;
+                continue;
+            }
+            if (isObject) {
+                if (*p != '"')
+                    return ParseFail;
+                ParseResult r = parseString(p, end, nullptr);
+                if (r != ParseOk)
+                    return r;
+                skipWhitespace(p, end);
+                if (p >= end)
+                    return ParseNeedMore;
+                if (*p != ':')
+                    return ParseFail;
+                ++p;
+            }
+            ParseResult r = skipValue(p, end, depth + 1);
+            if (r != ParseOk)
+                return r;
+        }
+    }
+    default:
+        return parseNumber(p, end, nullptr);
+    }
+}
+
+// 解析一个任务对象 (p 指向 '{')，只认 id / title / date / done / rank，其余字段跳过
+ParseResult parseTask(const char *&p, const char *end, TaskRecord &task) {
+    ++p;
+    while (true) {
+        skipWhitespace(p, end);
+        if (p >= end)
+            return ParseNeedMore;
+        if (*p == '}') {
+            ++p;
+            break;
+        }
+        if (*p == ',') {
+            ++p;
+            continue;
+        }
+        if (*p != '"')
+            return ParseFail;
+
+        const char *key = nullptr;
+        int keyLength = 0;
+        ParseResult r = parseKey(p, end, key, keyLength);
+        if (r != ParseOk)
+            return r;
+        skipWhitespace(p, end);
+        if (p >= end)
+            return ParseNeedMore;
+        if (*p != ':')
+            return ParseFail;
+        ++p;
+        skipWhitespace(p, end);
+        if (p >= end)
+            return ParseNeedMore;
+
+        if (keyIs(key, keyLength, "title") && *p == '"') {
+            r = parseString(p, end, &task.title);
+        } else if (keyIs(key, keyLength, "date") && *p == '"') {
+            QString date;
+            r = parseString(p, end, &date);
+            if (r == ParseOk)
+                task.setDate(date);
+        } else if (keyIs(key, keyLength, "id") && *p >= '0' && *p <= '9') {
+            quint64 id = 0;
+            r = parseNumber(p, end, &id);
+            if (r == ParseOk)
+                task.id = id <= 0xFFFFFFFFu ? static_cast<quint32>(id) : 0;
+        } else if (keyIs(key, keyLength, "rank") && *p == '"') {
+            QString rank;
+            r = parseString(p, end, &rank);
+            if (r == ParseOk)
+                task.rank = TaskRecord::parseRank(rank);
+        } else if (keyIs(key, keyLength, "done") && (*p == 't' || *p == 'f')) {
+            task.done = *p == 't';
+            r = parseLiteral(p, end, task.done ? "true" : "false");
+        } else {
+            r = skipValue(p, end);
+        }
+        if (r != ParseOk)
+            return r;
+    }
+
+    // 如果是旧数据没有 title 字段（兼容性处理）
+    if (task.title.isEmpty())
+        task.title = "旧任务";
+    return ParseOk;
+}
+
+} // namespace
+
+void TaskJsonReader::addData(const QByteArray &chunk) {
+    // 已经消费掉的字节丢掉，只留下还没解析完的尾巴
+    if (pos > 0) {
+        buffer.remove(0, pos);
+        pos = 0;
+    }
+    buffer.append(chunk);
+}
+
+void TaskJsonReader::finish() {
+    finished = true;
+}
+
+int TaskJsonReader::readTasks(QVector<TaskRecord> &out, int maxTasks) {
+    const char *data = buffer.constData();
+    const char *end = data + buffer.size();
+    const char *p = data + pos;
+    int count = 0;
+    bool starved = false; // 因为数据不够而停下
+
+    while (state != Done && state != Error && count < maxTasks) {
+        // 每一步都在副本 q 上解析，数据不够时 p 不动，下次从同一处重来
+        const char *q = p;
+        skipWhitespace(q, end);
+        if (q >= end) {
+            p = q;
+            starved = true;
+            break;
+        }
+
+        ParseResult r = ParseOk;
+        if (state == Start) {
+            if (*q == '[') {
+                rootIsArray = true;
+                state = InArray;
+                ++q;
+            } else if (*q == '{') {
+                state = InRoot;
+                ++q;
+            } else {
+                r = ParseFail;
+            }
+        } else if (state == InRoot) {
+            if (*q == '}') {
+                state = Done;
+                ++q;
+            } else if (*q == ',') {
+                ++q;
+            } else if (*q == '"') {
+                const char *key = nullptr;
+                int keyLength = 0;
+                r = parseKey(q, end, key, keyLength);
+                if (r == ParseOk) {
+                    skipWhitespace(q, end);
+                    if (q >= end)
+                        r = ParseNeedMore;
+                    else if (*q != ':')
+                        r = ParseFail;
+                    else {
+                        ++q;
+                        skipWhitespace(q, end);
+                        if (q >= end)
+                            r = ParseNeedMore;
+                    }
+                }
+                if (r == ParseOk) {
+                    if (keyIs(key, keyLength, "tasks") && *q == '[') {
+                        ++q;
+                        state = InArray;
+                    } else if (keyIs(key, keyLength, "generation")) {
+                        quint64 value = 0;
+                        r = parseNumber(q, end, &value);
+                        if (r == ParseOk) {
+                            gen = value;
+                            generationSeen = true;
+                        }
+                    } else {
+                        r = skipValue(q, end);
+                    }
+                }
+            } else {
+                r = ParseFail;
+            }
+        } else { // InArray
+            if (*q == ']') {
+                ++q;
+                state = rootIsArray ? Done : InRoot;
+            } else if (*q == ',') {
+                ++q;
+            } else if (*q == '{') {
+                TaskRecord task;
+                r = parseTask(q, end, task);
+                if (r == ParseOk) {
+                    out.append(task);
+                    ++count;
+                }
+            } else {
+                r = ParseFail;
+            }
+        }
+
+        if (r == ParseNeedMore) {
+            starved = true;
+            break;
+        }
+        if (r == ParseFail) {
+            state = Error;
+            break;
+        }
+        p = q;
+    }
+
+    pos = static_cast<int>(p - data);
+    // 数据已经全部喂完却还没读到结尾：文件被截断了
+    if (finished && starved && state != Done)
+        state = Error;
+    return count;
+}
@@ -0,0 +1,42 @@
+#ifndef TASKJSONREADER_H
+#define TASKJSONREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <climits>
+
+#include "taskmodel.h"
+
+// --- 流式 JSON 任务读取器 ---
+// 不建 QJsonDocument DOM：数据分块喂进来，边读边把 id/title/date/done/rank 直接填进 TaskRecord。
+// 认识两种根结构：旧版的纯数组 [...]，以及新版的 {"generation": N, "tasks": [...]}。
+// 手上只保留还没解析完的那一小段字节，峰值内存基本等于最终的任务列表本身。
+class TaskJsonReader {
+  public:
+    void addData(const QByteArray &chunk);
+    void finish(); // 告诉读取器后面没有数据了
+
+    // 尽量多地解析任务追加到 out，最多 maxTasks 条，返回本次解析出的条数
+    int readTasks(QVector<TaskRecord> &out, int maxTasks = INT_MAX);
+
+    bool atEnd() const { return state == Done; }
+    bool hasError() const { return state == Error; }
+    // 是否已经读到任务数组 (只想偷看 generation 时用)
+    bool reachedTasks() const { return state == InArray || state == Done; }
+    bool hasGeneration() const { return generationSeen; }
+    quint64 generation() const { return gen; }
+
+  private:
+    enum State { Start, InRoot, InArray, Done, Error };
+
+    QByteArray buffer;
+    int pos = 0; // buffer 里已经消费掉的字节数
+    bool finished = false;
+    State state = Start;
+    bool rootIsArray = false;
+    bool generationSeen = false;
+    quint64 gen = 0;
+};
+
+#endif // TASKJSONREADER_H
@@ -0,0 +1,55 @@
+#include "taskjsonwriter.h"
+
+void TaskJsonWriter::appendString(QByteArray &out, QStringView text) {
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = text.toUtf8();
+    out.reserve(out.size() + utf8.size() + 2);
+    out += '"';
+    // 只有引号、反斜杠和控制字符需要转义；多字节 UTF-8 原样写
+    const char *p = utf8.constData();
+    const char *end = p + utf8.size();
+    const char *segment = p;
+    for (; p < end; ++p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.append(segment, p - segment);
+        segment = p + 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(escape, 6);
+            break;
+        }
+        }
+    }
+    out.append(segment, end - segment);
+    out += '"';
+}
+
+void TaskJsonWriter::appendTask(QByteArray &out, quint32 id, QStringView title, QStringView date, bool done,
+                                quint64 rank) {
+    if (id) {
+        out += "{\"id\":";
+        out += QByteArray::number(id);
+        out += ",\"title\":";
+    } else {
+        out += "{\"title\":";
+    }
+    appendString(out, title);
+    out += ",\"date\":";
+    appendString(out, date);
+    out += done ? ",\"done\":true" : ",\"done\":false";
+    if (rank) {
+        // 64 位整数放进 JSON 数字会丢精度，写成定长十六进制字符串
+        out += ",\"rank\":\"";
+        out += QByteArray::number(rank, 16).rightJustified(16, '0');
+        out += '"';
+    }
+    out += '}';
+}
@@ -0,0 +1,21 @@
+#ifndef TASKJSONWRITER_H
+#define TASKJSONWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+
+// --- 流式 JSON 任务写出 ---
+// 和 TaskJsonReader 配对：不建 QJsonArray / QJsonObject，直接把字节追加到缓冲区，
+// 调用方攒够一块就写出去，百万条任务也不会在内存里多出一整份 DOM。
+class TaskJsonWriter {
+  public:
+    // 追加一个带引号、已转义的 JSON 字符串
+    static void appendString(QByteArray &out, QStringView text);
+    // 追加一个任务对象 {"id":...,"title":...,"date":...,"done":...,"rank":"..."} (不带逗号和换行)，
+    // id / rank 为 0 时不写
+    static void appendTask(QByteArray &out, quint32 id, QStringView title, QStringView date, bool done,
+                           quint64 rank = 0);
+};
+
+#endif // TASKJSONWRITER_H
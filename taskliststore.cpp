@@ -0,0 +1,243 @@
+#include "taskliststore.h"
+#include "taskdateindex.h"
+#include "taskfuzzysearch.h"
+#include "taskjournal.h"
+#include "taskmodel.h"
+#include "tasksearchindex.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSettings>
+#include <algorithm>
+
+// 清单目录；没有这个文件时只有一个默认清单，用的就是原来的 todo_data.json
+const QString MANIFEST_FILENAME = "todo_lists.json";
+const QString DEFAULT_LIST_NAME = "默认";
+const QString DEFAULT_LIST_FILE = "todo_data";
+// 新建的清单放在这个子目录里，文件名按序号取 (清单名里可能有文件名不允许的字符)
+const QString SHARD_DIR = "lists";
+
+TaskListStore::TaskListStore(int coalesceMs, int maxLoaded, QObject *parent)
+    : QObject(parent), coalesceMs(coalesceMs), maxLoaded(std::max(1, maxLoaded)) {
+    manifestPath = QCoreApplication::applicationDirPath() + "/" + MANIFEST_FILENAME;
+    readManifest();
+}
+
+TaskListStore::~TaskListStore() {
+    flushAll();
+    for (TaskList &list : lists)
+        release(list);
+}
+
+QStringList TaskListStore::names() const {
+    QStringList result;
+    for (const TaskList &list : lists)
+        result.append(list.name);
+    return result;
+}
+
+int TaskListStore::indexOf(const QString &name) const {
+    for (int i = 0; i < lists.size(); ++i) {
+        if (lists[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+const TaskList *TaskListStore::list(const QString &name) const {
+    const int i = indexOf(name);
+    return i < 0 ? nullptr : &lists[i];
+}
+
+QString TaskListStore::snapshotPath(const QString &name) const {
+    const int i = indexOf(name);
+    return i < 0 ? QString() : TaskJournal::defaultSnapshotPath(lists[i].file);
+}
+
+TaskList *TaskListStore::activate(const QString &name) {
+    const int i = indexOf(name);
+    if (i < 0)
+        return nullptr;
+    const bool changed = i != active;
+    active = i;
+    TaskList &list = lists[i];
+    list.lastUsed = ++useCounter;
+    if (!list.model)
+        load(list);
+    evict();
+    if (changed)
+        writeManifest();
+    return &lists[active];
+}
+
+bool TaskListStore::createList(const QString &name) {
+    if (name.isEmpty() || indexOf(name) >= 0)
+        return false;
+
+    // 找一个还没人用的分片序号
+    int number = 1;
+    QString file;
+    do {
+        file = QString("%1/list_%2").arg(SHARD_DIR).arg(number++);
+    } while (QFile::exists(TaskJournal::defaultSnapshotPath(file)) ||
+             QFile::exists(TaskJournal::alternatePath(TaskJournal::defaultSnapshotPath(file))) ||
+             std::any_of(lists.cbegin(), lists.cend(), [&](const TaskList &l) { return l.file == file; }));
+    QDir(QCoreApplication::applicationDirPath()).mkpath(SHARD_DIR);
+
+    TaskList list;
+    list.name = name;
+    list.file = file;
+    lists.append(list);
+    writeManifest();
+    return true;
+}
+
+void TaskListStore::load(TaskList &list) {
+    list.loaded = false;
+    list.model = new TaskModel(this);
+    // 索引挂在模型下面，清单被释放时跟着一起没
+    list.searchIndex = new TaskSearchIndex(list.model, list.model);
+    list.dateIndex = new TaskDateIndex(list.model, list.model);
+    list.fuzzySearch = new TaskFuzzySearch(list.model, list.model);
+    list.journal = new TaskJournal(TaskJournal::defaultSnapshotPath(list.file), coalesceMs, this);
+
+    const QString name = list.name;
+    // 二进制快照在 load() 里当场读完、当场发 loaded，那时 activate() 还没返回，
+    // 窗口还指着上一个清单；排到下一轮事件循环再通知。挂在日志上，清单先被释放了就不会再来
+    connect(list.journal, &TaskJournal::loaded, list.journal, [this, name]() {
+        const int i = indexOf(name);
+        if (i < 0 || !lists[i].model)
+            return;
+        lists[i].loaded = true;
+        lists[i].count = lists[i].model->rowCount();
+        emit listLoaded(name);
+    }, Qt::QueuedConnection);
+    connect(list.journal, &TaskJournal::externalChangesMerged, this, [this, name](int changedRows) {
+        const int i = indexOf(name);
+        if (i >= 0 && lists[i].model)
+            lists[i].count = lists[i].model->rowCount();
+        emit listChangedOnDisk(name, changedRows);
+    });
+    // 别的程序改了分片文件时合并进来 (设置 watchDataFile=false 可以关掉)
+    list.journal->setWatching(QSettings("MySoft", "ToDoList").value("watchDataFile", true).toBool());
+    list.journal->load(list.model);
+}
+
+void TaskListStore::release(TaskList &list) {
+    if (!list.model)
+        return;
+    list.count = list.model->rowCount();
+    // 日志的析构会等工作线程把没写完的都写盘
+    delete list.journal;
+    delete list.model;
+    list.journal = nullptr;
+    list.model = nullptr;
+    list.searchIndex = nullptr;
+    list.dateIndex = nullptr;
+    list.fuzzySearch = nullptr;
+    list.loaded = false;
+}
+
+// 加载着的清单超过上限时，从最久没看的开始释放 (当前清单和还在读的不动)
+void TaskListStore::evict() {
+    while (true) {
+        int resident = 0;
+        int oldest = -1;
+        for (int i = 0; i < lists.size(); ++i) {
+            if (!lists[i].model)
+                continue;
+            ++resident;
+            if (i != active && lists[i].loaded && (oldest < 0 || lists[i].lastUsed < lists[oldest].lastUsed))
+                oldest = i;
+        }
+        if (resident <= maxLoaded || oldest < 0)
+            break;
+        release(lists[oldest]);
+        writeManifest(); // 条数变了
+    }
+}
+
+void TaskListStore::releaseInactive() {
+    bool released = false;
+    for (int i = 0; i < lists.size(); ++i) {
+        if (i != active && lists[i].model && lists[i].loaded) {
+            release(lists[i]);
+            released = true;
+        }
+    }
+    if (released)
+        writeManifest();
+}
+
+void TaskListStore::flushAll() {
+    bool any = false;
+    for (TaskList &list : lists) {
+        if (!list.model)
+            continue;
+        list.journal->flush();
+        if (list.loaded)
+            list.count = list.model->rowCount();
+        any = true;
+    }
+    // 什么都没加载 (比如命令行模式只是查一下路径) 时不用动目录
+    if (any)
+        writeManifest();
+}
+
+void TaskListStore::readManifest() {
+    lists.clear();
+    active = 0;
+
+    QFile file(manifestPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        const QJsonArray array = root["lists"].toArray();
+        for (const QJsonValue &value : array) {
+            const QJsonObject obj = value.toObject();
+            TaskList list;
+            list.name = obj["name"].toString();
+            list.file = obj["file"].toString();
+            list.count = static_cast<qint64>(obj["count"].toDouble());
+            // 名字重复或文件名想跳出程序目录的条目不要
+            if (list.name.isEmpty() || list.file.isEmpty() || list.file.contains("..") || indexOf(list.name) >= 0)
+                continue;
+            lists.append(list);
+        }
+        active = std::max(0, indexOf(root["active"].toString()));
+    }
+
+    if (lists.isEmpty()) {
+        TaskList list;
+        list.name = DEFAULT_LIST_NAME;
+        list.file = DEFAULT_LIST_FILE;
+        lists.append(list);
+    }
+}
+
+void TaskListStore::writeManifest() const {
+    QJsonArray array;
+    for (const TaskList &list : lists) {
+        QJsonObject obj;
+        obj["name"] = list.name;
+        obj["file"] = list.file;
+        obj["count"] = static_cast<double>(list.count);
+        array.append(obj);
+    }
+    QJsonObject root;
+    root["active"] = activeName();
+    root["lists"] = array;
+
+    QSaveFile file(manifestPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Z-Td: cannot write list manifest" << manifestPath;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson());
+    if (!file.commit())
+        qWarning() << "Z-Td: cannot write list manifest" << manifestPath;
+}
@@ -0,0 +1,78 @@
+#ifndef TASKLISTSTORE_H
+#define TASKLISTSTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class TaskDateIndex;
+class TaskFuzzySearch;
+class TaskJournal;
+class TaskModel;
+class TaskSearchIndex;
+
+// 一个清单：分片文件名 + (加载了的话) 它的模型、日志、两个索引和模糊搜索
+struct TaskList {
+    QString name;
+    QString file;       // 分片文件名，不带后缀，相对程序目录 (默认清单就是原来的 todo_data)
+    qint64 count = 0;   // 上次加载时的任务条数，没加载也能在下拉框里显示
+    qint64 lastUsed = 0; // 最近一次切到它的序号，越大越新
+    bool loaded = false; // 快照和日志都读完了
+    TaskModel *model = nullptr; // 为空 = 没在内存里
+    TaskJournal *journal = nullptr;
+    TaskSearchIndex *searchIndex = nullptr;
+    TaskDateIndex *dateIndex = nullptr;
+    TaskFuzzySearch *fuzzySearch = nullptr;
+};
+
+// --- 多清单存储 ---
+// 每个清单一份独立的分片 (快照 + 日志，格式同 TaskJournal)，
+// 程序目录下的 todo_lists.json 只记清单名、分片文件和条数：
+//   {"active": "默认", "lists": [{"name": "默认", "file": "todo_data", "count": 12}, ...]}
+// 启动时只加载当前清单，别的清单切过去时才读；
+// 内存里最多留 maxLoaded 个，超出时把最久没看的那个写盘后整个释放。
+class TaskListStore : public QObject {
+    Q_OBJECT
+
+  public:
+    TaskListStore(int coalesceMs, int maxLoaded, QObject *parent = nullptr);
+    ~TaskListStore();
+
+    QStringList names() const;
+    QString activeName() const { return lists.isEmpty() ? QString() : lists[active].name; }
+    const TaskList *list(const QString &name) const;
+    // 清单名对应的快照文件，找不到返回空 (命令行模式用，不加载)
+    QString snapshotPath(const QString &name) const;
+
+    // 切到这个清单，没加载就现在开始加载 (JSON 分片是流式读的，读完发 listLoaded)
+    TaskList *activate(const QString &name);
+    // 新建一个空清单，重名或名字为空时返回 false
+    bool createList(const QString &name);
+    // 释放除当前清单以外的全部清单 (窗口藏起来时用)
+    void releaseInactive();
+    // 把所有加载着的清单写盘，并更新目录里的条数 (退出时用)
+    void flushAll();
+
+  signals:
+    void listLoaded(const QString &name);
+    // 分片文件被别的程序改过，已经合并进这个清单
+    void listChangedOnDisk(const QString &name, int changedRows);
+
+  private:
+    int indexOf(const QString &name) const;
+    void load(TaskList &list);
+    void release(TaskList &list);
+    void evict();
+    void readManifest();
+    void writeManifest() const;
+
+    QVector<TaskList> lists;
+    int active = 0;
+    int coalesceMs;
+    int maxLoaded;
+    qint64 useCounter = 0;
+    QString manifestPath;
+};
+
+#endif // TASKLISTSTORE_H
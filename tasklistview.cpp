@@ -0,0 +1,20 @@
+#include "tasklistview.h"
+#include "tracer.h"
+
+TaskListView::TaskListView(QWidget *parent) : QListView(parent) {
+}
+
+void TaskListView::paintEvent(QPaintEvent *event) {
+    TraceSpan span("taskList.paint");
+    QListView::paintEvent(event);
+}
+
+void TaskListView::doItemsLayout() {
+    TraceSpan span("taskList.layout");
+    QListView::doItemsLayout();
+}
+
+void TaskListView::updateGeometries() {
+    TraceSpan span("taskList.updateGeometries");
+    QListView::updateGeometries();
+}
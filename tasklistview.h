@@ -0,0 +1,19 @@
+#ifndef TASKLISTVIEW_H
+#define TASKLISTVIEW_H
+
+#include <QListView>
+
+// 任务列表视图：和 QListView 一样，只是把绘制和布局包进跟踪区间 (见 Tracer)
+class TaskListView : public QListView {
+    Q_OBJECT
+
+  public:
+    explicit TaskListView(QWidget *parent = nullptr);
+
+  protected:
+    void paintEvent(QPaintEvent *event) override;
+    void doItemsLayout() override;
+    void updateGeometries() override;
+};
+
+#endif // TASKLISTVIEW_H
@@ -0,0 +1,161 @@
+#include "taskmerge.h"
+#include "tracer.h"
+#include <QMultiHash>
+#include <QPair>
+#include <algorithm>
+
+namespace {
+
+bool inBase(const QBitArray &baseIds, quint32 id) {
+    return id < quint32(baseIds.size()) && baseIds.testBit(id);
+}
+
+QString contentKey(QStringView date, QStringView title) {
+    QString key;
+    key.reserve(date.size() + 1 + title.size());
+    key += date;
+    key += QLatin1Char('\n');
+    key += title;
+    return key;
+}
+
+TaskRecord recordAt(const TaskTable &table, int row) {
+    TaskRecord task;
+    task.id = table.row(row).id;
+    task.title = table.title(row).toString();
+    task.setDate(table.dateText(row));
+    task.done = table.isDone(row);
+    task.rank = table.rank(row);
+    return task;
+}
+
+} // namespace
+
+int TaskMerge::merge(TaskModel *ours, const TaskTable &theirs, const QBitArray &baseIds,
+                     const QHash<quint32, quint8> &dirty) {
+    TraceSpan span("journal.merge");
+    const int ourCount = ours->rowCount();
+    QBitArray matched(ourCount);
+
+    // 没有编号的行才需要按内容找，有的话建一次 (只收本地还没对上的行，第一次用到时再建)
+    QMultiHash<QString, int> byContent;
+    bool contentBuilt = false;
+
+    struct Update {
+        int row;
+        quint8 fields;
+        int theirRow;
+    };
+    QVector<Update> updates;
+    QVector<QPair<quint32, quint64>> reorders; // 跟着文件换顺序键的 (编号, 新键)
+    // 文件里新加的任务：带顺序键的按键插；没带的按"插在哪个编号后面"分组 (0 = 最前面)，组内保持文件里的顺序
+    QVector<TaskRecord> rankedInserts;
+    QVector<QPair<quint32, QVector<TaskRecord>>> inserts;
+    quint32 anchor = 0;
+
+    for (int t = 0; t < theirs.size(); ++t) {
+        const quint32 id = theirs.row(t).id;
+        int row = id ? ours->rowForId(id) : -1;
+        if (row >= 0 && matched.testBit(row))
+            row = -1; // 文件里重复的编号，后面那条当成新的
+        if (row >= 0 && !inBase(baseIds, id) &&
+            (ours->title(row) != theirs.title(t) || ours->date(row) != theirs.dateText(t)))
+            row = -1; // 两边各自新加、碰巧发了同一个编号：是两条不同的任务
+
+        if (row < 0 && id == 0) {
+            if (!contentBuilt) {
+                for (int r = 0; r < ourCount; ++r)
+                    byContent.insert(contentKey(ours->date(r), ours->title(r)), r);
+                contentBuilt = true;
+            }
+            const QString key = contentKey(theirs.dateText(t), theirs.title(t));
+            const auto range = byContent.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (!matched.testBit(it.value())) {
+                    row = it.value();
+                    break;
+                }
+            }
+        }
+
+        if (row < 0) {
+            // 本地删掉的不加回来
+            if (id && inBase(baseIds, id))
+                continue;
+            if (theirs.rank(t)) {
+                rankedInserts.append(recordAt(theirs, t));
+                continue;
+            }
+            if (inserts.isEmpty() || inserts.last().first != anchor)
+                inserts.append({anchor, {}});
+            inserts.last().second.append(recordAt(theirs, t));
+            continue;
+        }
+
+        matched.setBit(row);
+        anchor = ours->taskId(row);
+        const quint8 mine = dirty.value(anchor, 0);
+        quint8 fields = 0;
+        if (!(mine & TitleField) && ours->title(row) != theirs.title(t))
+            fields |= TitleField;
+        if (!(mine & DateField) && ours->date(row) != theirs.dateText(t))
+            fields |= DateField;
+        if (!(mine & DoneField) && ours->isDone(row) != theirs.isDone(t))
+            fields |= DoneField;
+        if (fields)
+            updates.append({row, fields, t});
+        if (!(mine & OrderField) && theirs.rank(t) && ours->rank(row) != theirs.rank(t))
+            reorders.append({anchor, theirs.rank(t)});
+    }
+
+    // 1. 改字段 (不动行号)
+    for (const Update &u : std::as_const(updates)) {
+        if (u.fields & TitleField)
+            ours->setTitle(u.row, theirs.title(u.theirRow).toString());
+        if (u.fields & DateField)
+            ours->setDate(u.row, theirs.dateText(u.theirRow));
+        if (u.fields & DoneField)
+            ours->setDone(u.row, theirs.isDone(u.theirRow));
+    }
+
+    // 2. 删除：文件里没有、本地也没新加或改过的。从后往前按连续段删，前面的行号不受影响
+    auto doomed = [&](int r) {
+        const quint32 id = ours->taskId(r);
+        return !matched.testBit(r) && inBase(baseIds, id) && !dirty.contains(id);
+    };
+    int removed = 0;
+    for (int row = ourCount - 1; row >= 0;) {
+        if (!doomed(row)) {
+            --row;
+            continue;
+        }
+        const int last = row;
+        while (row >= 0 && doomed(row))
+            --row;
+        ours->removeRows(row + 1, last - row);
+        removed += last - row;
+    }
+
+    // 3. 插入：先把每组的位置算好，再从后往前插
+    QVector<QPair<int, int>> positions; // (插入位置, 组下标)
+    positions.reserve(inserts.size());
+    for (int i = 0; i < inserts.size(); ++i) {
+        const quint32 after = inserts[i].first;
+        positions.append({after ? ours->rowForId(after) + 1 : 0, i});
+    }
+    std::sort(positions.begin(), positions.end(), [](const QPair<int, int> &a, const QPair<int, int> &b) {
+        return a.first > b.first;
+    });
+    int inserted = 0;
+    for (const auto &p : std::as_const(positions)) {
+        ours->insertTasks(p.first, inserts[p.second].second);
+        inserted += inserts[p.second].second.size();
+    }
+    ours->insertRanked(rankedInserts);
+    inserted += rankedInserts.size();
+
+    // 4. 换顺序：按编号找行，挪到新键的位置
+    ours->applyRanks(reorders);
+
+    return updates.size() + reorders.size() + removed + inserted;
+}
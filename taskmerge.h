@@ -0,0 +1,33 @@
+#ifndef TASKMERGE_H
+#define TASKMERGE_H
+
+#include <QBitArray>
+#include <QHash>
+
+#include "taskmodel.h"
+
+// --- 按编号的三方合并 ---
+// 任务文件被别的程序改了 (同步盘、脚本、另一台机器) 时，把文件里的版本合并进内存里的模型。
+// "共同祖先"不存整份副本，只记两样东西：
+//   baseIds  上次和磁盘一致时有哪些编号 (一个编号一位)
+//   dirty    那之后本地改过哪些任务的哪些字段 (只有改过的才有一项)
+// 规则：
+//   两边都有：本地没改过的字段跟文件走；本地改过的字段留本地 (两边都改了同一字段也是本地赢)
+//   只有文件有：本来就有 (在 baseIds 里) = 本地删的，不加回来；否则是文件新加的，
+//             按它的顺序键插到该在的位置 (没有键的插在它在文件里的前一条后面)
+//   只有本地有：本地新加的、或者本地改过的，留着；其余说明文件里删了，跟着删
+//   文件里没有编号的行 (旧工具写的) 按 日期 + 标题 找本地还没对上的行
+// 顺序也按字段合并：顺序键就是"排在哪"，本地没挪过的任务跟文件里的键走，挪过的留本地的键，
+// 两边各自的拖动排序都保留下来。文件里没有顺序键 (旧工具写的) 时顺序以本地为准。
+// 只对真正变了的行发信号 (改字段 / 挪 / 删 / 插)，列表的滚动位置和选中项都不动；
+// 比较是一遍哈希查表，和任务数成线性，动模型的开销只和改动的条数有关。
+class TaskMerge {
+  public:
+    enum Field : quint8 { TitleField = 0x1, DateField = 0x2, DoneField = 0x4, OrderField = 0x8 };
+
+    // 返回改动的行数 (改字段 + 挪位置 + 删除 + 插入)
+    static int merge(TaskModel *ours, const TaskTable &theirs, const QBitArray &baseIds,
+                     const QHash<quint32, quint8> &dirty);
+};
+
+#endif // TASKMERGE_H
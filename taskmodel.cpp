@@ -0,0 +1,722 @@
+#include "taskmodel.h"
+#include "taskbinaryfile.h"
+#include "tracer.h"
+#include <QDate>
+#include <algorithm>
+
+// 带进来的编号最多比 2 × 条数大这么多，再大就当成手改坏的，重新发一个 (编号对照表按编号开数组)
+static const quint32 MAX_ID_GAP = 65536;
+// 已完成的任务分散成这么多段以上时，逐段删除要反复搬动后面的记录，不如整体压缩一遍
+static const int MAX_RANGE_REMOVALS = 16;
+// 追加的任务顺序键相隔这么远：在同一处接连插 32 次才需要重新拉开
+static const quint64 RANK_STEP = quint64(1) << 32;
+static const quint64 RANK_MAX = ~quint64(0);
+// 重新拉开时，附近这一段相邻的键至少隔这么远，不够就把范围扩大一倍
+static const quint64 MIN_SPREAD_GAP = quint64(1) << 16;
+// 一次改这么多条以上的顺序键 (外部把整个文件重排过)，逐条挪不如整表按键排一遍
+static const int MAX_SINGLE_MOVES = 64;
+
+qint32 TaskRecord::parseDay(QStringView text) {
+    if (text.size() != 10 || text[4] != u'-' || text[7] != u'-')
+        return 0;
+    auto number = [&](int from, int length) {
+        int value = 0;
+        for (int i = from; i < from + length; ++i) {
+            const char16_t c = text[i].unicode();
+            if (c < u'0' || c > u'9')
+                return -1;
+            value = value * 10 + (c - u'0');
+        }
+        return value;
+    };
+    const int y = number(0, 4), m = number(5, 2), d = number(8, 2);
+    if (y < 0 || m < 0 || d < 0)
+        return 0;
+    const QDate date(y, m, d);
+    return date.isValid() ? static_cast<qint32>(date.toJulianDay()) : 0;
+}
+
+QString TaskRecord::formatDay(qint32 day) {
+    int y, m, d;
+    QDate::fromJulianDay(day).getDate(&y, &m, &d);
+    if (y < 1 || y > 9999)
+        return QString();
+    char16_t text[10];
+    text[0] = u'0' + y / 1000;
+    text[1] = u'0' + y / 100 % 10;
+    text[2] = u'0' + y / 10 % 10;
+    text[3] = u'0' + y % 10;
+    text[4] = u'-';
+    text[5] = u'0' + m / 10;
+    text[6] = u'0' + m % 10;
+    text[7] = u'-';
+    text[8] = u'0' + d / 10;
+    text[9] = u'0' + d % 10;
+    return QString(reinterpret_cast<const QChar *>(text), 10);
+}
+
+void TaskRecord::setDate(const QString &text) {
+    day = parseDay(text);
+    rawDate = day ? QString() : text;
+}
+
+quint64 TaskRecord::parseRank(QStringView text) {
+    if (text.size() != 16)
+        return 0;
+    quint64 value = 0;
+    for (const QChar ch : text) {
+        const char16_t c = ch.unicode();
+        int digit;
+        if (c >= u'0' && c <= u'9')
+            digit = c - u'0';
+        else if (c >= u'a' && c <= u'f')
+            digit = c - u'a' + 10;
+        else if (c >= u'A' && c <= u'F')
+            digit = c - u'A' + 10;
+        else
+            return 0;
+        value = value << 4 | quint64(digit);
+    }
+    return value;
+}
+
+QString TaskRecord::formatRank(quint64 rank) {
+    return QString::number(rank, 16).rightJustified(16, u'0');
+}
+
+QString TaskRecord::dateText() const {
+    return day ? formatDay(day) : rawDate;
+}
+
+// 标题长度只有 30 位
+static const qsizetype MAX_TITLE_LENGTH = (1 << 30) - 1;
+// arena 里的垃圾超过这么多、并且超过一半时才压缩，免得小列表反复重建
+static const qsizetype MIN_SQUEEZE_GARBAGE = 64 * 1024;
+
+void TaskTable::reserve(int count, qsizetype titleChars) {
+    rows.reserve(count);
+    if (titleChars > 0)
+        arena.reserve(titleChars);
+}
+
+QStringView TaskTable::title(int i) const {
+    const TaskRow &r = rows[i];
+    if (r.mapped)
+        return QStringView();
+    return QStringView(arena).mid(r.offset, r.length);
+}
+
+QString TaskTable::dateText(int i) const {
+    const qint32 day = rows[i].day;
+    if (day > 0)
+        return TaskRecord::formatDay(day);
+    if (day < 0)
+        return rawDates[-day - 1];
+    return QString();
+}
+
+qint32 TaskTable::internRawDate(const QString &text) {
+    if (text.isEmpty())
+        return 0;
+    auto it = rawDateIndex.constFind(text);
+    if (it != rawDateIndex.constEnd())
+        return it.value();
+    rawDates.append(text);
+    const qint32 day = -static_cast<qint32>(rawDates.size());
+    rawDateIndex.insert(text, day);
+    return day;
+}
+
+void TaskTable::appendTitle(TaskRow &r, QStringView title) {
+    const qsizetype length = std::min(title.size(), MAX_TITLE_LENGTH);
+    r.offset = static_cast<quint32>(arena.size());
+    r.length = static_cast<quint32>(length);
+    r.mapped = 0;
+    arena.append(title.constData(), length);
+}
+
+void TaskTable::dropTitle(const TaskRow &r) {
+    if (!r.mapped)
+        garbage += r.length;
+}
+
+TaskRow TaskTable::makeRow(const TaskRecord &task) {
+    TaskRow r;
+    r.id = task.id;
+    r.day = task.day ? task.day : internRawDate(task.rawDate);
+    r.done = task.done;
+    r.rank = task.rank;
+    appendTitle(r, task.title);
+    return r;
+}
+
+void TaskTable::append(const TaskRecord &task) {
+    rows.append(makeRow(task));
+}
+
+void TaskTable::insert(int i, const TaskRecord &task) {
+    rows.insert(i, makeRow(task));
+}
+
+void TaskTable::appendMapped(quint32 id, qint32 day, bool done, quint64 rank, quint32 fileRow) {
+    TaskRow r;
+    r.id = id;
+    r.day = day;
+    r.done = done;
+    r.rank = rank;
+    r.offset = fileRow;
+    r.mapped = 1;
+    rows.append(r);
+}
+
+void TaskTable::setTitle(int i, QStringView title) {
+    dropTitle(rows[i]);
+    appendTitle(rows[i], title);
+    if (garbage > MIN_SQUEEZE_GARBAGE && garbage > arena.size() / 2)
+        squeeze();
+}
+
+void TaskTable::setDate(int i, const QString &date) {
+    const qint32 day = TaskRecord::parseDay(date);
+    rows[i].day = day ? day : internRawDate(date);
+}
+
+void TaskTable::remove(int first, int count) {
+    for (int i = first; i < first + count; ++i)
+        dropTitle(rows[i]);
+    rows.remove(first, count);
+    if (garbage > MIN_SQUEEZE_GARBAGE && garbage > arena.size() / 2)
+        squeeze();
+}
+
+int TaskTable::removeDone() {
+    const int before = rows.size();
+    rows.erase(std::remove_if(rows.begin(), rows.end(),
+                              [this](const TaskRow &r) {
+                                  if (r.done)
+                                      dropTitle(r);
+                                  return r.done;
+                              }),
+               rows.end());
+    if (garbage > MIN_SQUEEZE_GARBAGE && garbage > arena.size() / 2)
+        squeeze();
+    return before - rows.size();
+}
+
+void TaskTable::move(int first, int count, int destination) {
+    // std::rotate 只搬动起点和终点之间的行 (每行 24 字节)，不动列表其余部分
+    auto begin = rows.begin() + first;
+    auto end = begin + count;
+    if (destination < first)
+        std::rotate(rows.begin() + destination, begin, end);
+    else
+        std::rotate(begin, end, rows.begin() + destination);
+}
+
+void TaskTable::sortByRank() {
+    std::stable_sort(rows.begin(), rows.end(), [](const TaskRow &a, const TaskRow &b) { return a.rank < b.rank; });
+}
+
+void TaskTable::resolve(int i, const TaskBinaryFile &file) {
+    TaskRow &r = rows[i];
+    if (!r.mapped)
+        return;
+    const int fileRow = static_cast<int>(r.offset);
+    if (r.day == 0)
+        r.day = internRawDate(file.date(fileRow));
+    appendTitle(r, file.title(fileRow));
+}
+
+void TaskTable::materialize(const TaskBinaryFile &file) {
+    for (int i = 0; i < rows.size(); ++i)
+        resolve(i, file);
+}
+
+void TaskTable::squeeze() {
+    QString compacted;
+    compacted.reserve(arena.size() - garbage);
+    for (TaskRow &r : rows) {
+        if (r.mapped)
+            continue;
+        const quint32 offset = static_cast<quint32>(compacted.size());
+        compacted.append(arena.constData() + r.offset, r.length);
+        r.offset = offset;
+    }
+    arena = compacted;
+    garbage = 0;
+}
+
+qsizetype TaskTable::memoryUsage() const {
+    qsizetype bytes = rows.capacity() * qsizetype(sizeof(TaskRow)) + arena.capacity() * qsizetype(sizeof(QChar));
+    for (const QString &raw : rawDates)
+        bytes += raw.capacity() * qsizetype(sizeof(QChar));
+    return bytes;
+}
+
+TaskModel::TaskModel(QObject *parent) : QAbstractListModel(parent) {
+}
+
+int TaskModel::rowCount(const QModelIndex &parent) const {
+    // 列表模型：只有根节点有子行
+    if (parent.isValid())
+        return 0;
+    return tasks.size();
+}
+
+QString TaskModel::title(int row) const {
+    const TaskRow &r = tasks.row(row);
+    return r.mapped ? mapped->title(r.offset) : tasks.title(row).toString();
+}
+
+QString TaskModel::date(int row) const {
+    const TaskRow &r = tasks.row(row);
+    if (r.mapped && r.day == 0)
+        return mapped->date(r.offset);
+    return tasks.dateText(row);
+}
+
+QString TaskModel::displayText(int row) const {
+    return QString("[%1] %2").arg(date(row), title(row));
+}
+
+int TaskModel::rowForId(quint32 id) const {
+    if (idToRowDirty) {
+        idToRow.fill(-1, nextId);
+        for (int row = 0; row < tasks.size(); ++row)
+            idToRow[tasks.row(row).id] = row;
+        idToRowDirty = false;
+    }
+    return id < static_cast<quint32>(idToRow.size()) ? idToRow[id] : -1;
+}
+
+void TaskModel::prepareIdLookup(const QVector<TaskRecord> &batch) const {
+    // 带来的编号都比现有的大 (或者根本没带) 就不可能撞号，不用为了查重去重建对照表；
+    // 重放日志时一条接一条地插，这样才不会每条都重建一遍
+    for (const TaskRecord &task : batch) {
+        if (task.id && task.id < nextId) {
+            rowForId(0);
+            return;
+        }
+    }
+}
+
+void TaskModel::claimIds(int first, int count) {
+    // 新行 [first, first + count) 已经在表里，对照表只登记了别的行 (见 prepareIdLookup)。
+    // 行里带来的编号能用就照用；没有、撞号或者大得离谱的才发新的
+    const quint64 limit = 2 * quint64(tasks.size()) + MAX_ID_GAP;
+    for (int row = first; row < first + count; ++row) {
+        const quint32 id = tasks.row(row).id;
+        if (id && id <= limit)
+            nextId = std::max(nextId, id + 1);
+    }
+    if (idToRow.size() < qsizetype(nextId))
+        idToRow.resize(nextId, -1);
+    for (int row = first; row < first + count; ++row) {
+        quint32 id = tasks.row(row).id;
+        if (id == 0 || id > limit || idToRow[id] >= 0) {
+            idsReassigned = true;
+            id = nextId++;
+            tasks.setId(row, id);
+            idToRow.resize(nextId, -1);
+        }
+        idToRow[id] = row;
+    }
+}
+
+qsizetype TaskModel::memoryUsage() const {
+    return tasks.memoryUsage() + idToRow.capacity() * qsizetype(sizeof(int));
+}
+
+QVariant TaskModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= tasks.size())
+        return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        // 显示文字不再常驻内存，画到哪一行才拼到哪一行
+        return displayText(index.row());
+    case Qt::EditRole:
+    case TitleRole:
+        return title(index.row());
+    case DateRole:
+        return date(index.row());
+    case IdRole:
+        return taskId(index.row());
+    case RankRole:
+        return TaskRecord::formatRank(rank(index.row()));
+    case Qt::CheckStateRole:
+        return isDone(index.row()) ? Qt::Checked : Qt::Unchecked;
+    default:
+        return QVariant();
+    }
+}
+
+bool TaskModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    if (!index.isValid() || index.row() >= tasks.size() || readOnly)
+        return false;
+
+    if (role == Qt::CheckStateRole) {
+        setDone(index.row(), static_cast<Qt::CheckState>(value.toInt()) == Qt::Checked);
+        return true;
+    }
+    if (role == Qt::EditRole || role == TitleRole) {
+        setTitle(index.row(), value.toString());
+        return true;
+    }
+    return false;
+}
+
+Qt::ItemFlags TaskModel::flags(const QModelIndex &index) const {
+    // 空白处 (根节点) 允许放下，任务本身只能拖、不能被“放到上面”
+    if (!index.isValid())
+        return readOnly ? Qt::NoItemFlags : Qt::ItemIsDropEnabled;
+    if (readOnly)
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable | Qt::ItemIsDragEnabled;
+}
+
+Qt::DropActions TaskModel::supportedDropActions() const {
+    return Qt::MoveAction;
+}
+
+bool TaskModel::moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                         const QModelIndex &destinationParent, int destinationChild) {
+    if (sourceParent.isValid() || destinationParent.isValid() || count <= 0)
+        return false;
+    if (sourceRow < 0 || sourceRow + count > tasks.size() || destinationChild < 0 || destinationChild > tasks.size())
+        return false;
+    // 放回原位 (或自己内部) 什么都不用做
+    if (destinationChild >= sourceRow && destinationChild <= sourceRow + count)
+        return false;
+
+    // 挪过去的几条取目标位置前后两行中间的键，别的行的键都不动 (那里挤满了才先把附近拉开)
+    const QVector<quint64> ranks = freshRanks(destinationChild, count);
+    if (!beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1, QModelIndex(), destinationChild))
+        return false;
+
+    tasks.move(sourceRow, count, destinationChild);
+    const int first = destinationChild < sourceRow ? destinationChild : destinationChild - count;
+    for (int i = 0; i < count; ++i)
+        tasks.setRank(first + i, ranks[i]);
+    idToRowDirty = true;
+
+    endMoveRows();
+    return true;
+}
+
+bool TaskModel::removeRows(int row, int count, const QModelIndex &parent) {
+    if (parent.isValid() || count <= 0 || row < 0 || row + count > tasks.size())
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row + count - 1);
+    tasks.remove(row, count);
+    idToRowDirty = true;
+    endRemoveRows();
+    return true;
+}
+
+int TaskModel::removeDone() {
+    TraceSpan span("removeDone");
+    // 先找出所有连续的已完成段 [first, last)
+    QVector<QPair<int, int>> runs;
+    int removed = 0;
+    for (int row = 0; row < tasks.size();) {
+        if (!tasks.isDone(row)) {
+            ++row;
+            continue;
+        }
+        const int first = row;
+        while (row < tasks.size() && tasks.isDone(row))
+            ++row;
+        runs.append({first, row});
+        removed += row - first;
+    }
+    if (runs.isEmpty())
+        return 0;
+
+    if (runs.size() <= MAX_RANGE_REMOVALS) {
+        // 从后往前删，前面各段的行号不受影响
+        for (int i = runs.size() - 1; i >= 0; --i)
+            removeRows(runs[i].first, runs[i].second - runs[i].first);
+        return removed;
+    }
+
+    emit doneAboutToBeCleared();
+    beginResetModel();
+    tasks.removeDone();
+    idToRowDirty = true;
+    endResetModel();
+    return removed;
+}
+
+void TaskModel::appendTask(const TaskRecord &task) {
+    appendTasks({task});
+}
+
+void TaskModel::appendTasks(const QVector<TaskRecord> &batch) {
+    if (batch.isEmpty())
+        return;
+    const int first = tasks.size();
+    prepareIdLookup(batch);
+    const QVector<quint64> ranks = planRanks(first, batch);
+    beginInsertRows(QModelIndex(), first, first + batch.size() - 1);
+    tasks.reserve(first + batch.size());
+    for (int i = 0; i < batch.size(); ++i) {
+        tasks.append(batch[i]);
+        tasks.setRank(first + i, ranks[i]);
+    }
+    // 追加在末尾不影响别的行号，对照表顺手补上即可
+    claimIds(first, batch.size());
+    endInsertRows();
+}
+
+void TaskModel::insertTask(int row, const TaskRecord &task) {
+    insertTasks(row, {task});
+}
+
+void TaskModel::insertTasks(int row, const QVector<TaskRecord> &batch) {
+    if (batch.isEmpty())
+        return;
+    const bool atEnd = row == tasks.size();
+    prepareIdLookup(batch);
+    const QVector<quint64> ranks = planRanks(row, batch);
+    beginInsertRows(QModelIndex(), row, row + batch.size() - 1);
+    for (int i = 0; i < batch.size(); ++i) {
+        tasks.insert(row + i, batch[i]);
+        tasks.setRank(row + i, ranks[i]);
+    }
+    // 后面的行往后挪了，对照表里它们的行号过时了，但"这个编号有没有人用"还是对的，查重够用
+    claimIds(row, batch.size());
+    if (!atEnd)
+        idToRowDirty = true;
+    endInsertRows();
+}
+
+void TaskModel::insertRanked(const QVector<TaskRecord> &batch) {
+    // 带键的按键排好，落在同一个位置的一段一次插进去；从后往前插，前面算好的位置不受影响
+    QVector<TaskRecord> ranked, unranked;
+    for (const TaskRecord &task : batch)
+        (task.rank ? ranked : unranked).append(task);
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const TaskRecord &a, const TaskRecord &b) { return a.rank < b.rank; });
+
+    QVector<QPair<int, int>> groups; // (插入位置, 在 ranked 里的起点)
+    for (int i = 0; i < ranked.size(); ++i) {
+        const int position = rankPosition(ranked[i].rank, 0, tasks.size());
+        if (groups.isEmpty() || groups.last().first != position)
+            groups.append({position, i});
+    }
+    for (int g = groups.size() - 1; g >= 0; --g) {
+        const int begin = groups[g].second;
+        const int end = g + 1 < groups.size() ? groups[g + 1].second : ranked.size();
+        insertTasks(groups[g].first, ranked.mid(begin, end - begin));
+    }
+    appendTasks(unranked);
+}
+
+void TaskModel::applyRanks(const QVector<QPair<quint32, quint64>> &ranks) {
+    if (ranks.size() > MAX_SINGLE_MOVES) {
+        // 整表按键重排一次，不 reset：视图拿着的索引按编号挪到新行上，选中项和滚动位置都还在
+        emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+        const QModelIndexList before = persistentIndexList();
+        QVector<quint32> heldIds(before.size());
+        for (int i = 0; i < before.size(); ++i)
+            heldIds[i] = taskId(before[i].row());
+        QVector<QPair<quint32, quint64>> applied;
+        for (const auto &entry : ranks) {
+            const int row = rowForId(entry.first);
+            if (row >= 0 && entry.second && tasks.rank(row) != entry.second) {
+                tasks.setRank(row, entry.second);
+                applied.append(entry);
+            }
+        }
+        tasks.sortByRank();
+        idToRowDirty = true;
+        QModelIndexList after;
+        after.reserve(heldIds.size());
+        for (const quint32 id : std::as_const(heldIds))
+            after.append(index(rowForId(id)));
+        changePersistentIndexList(before, after);
+        emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+        if (!applied.isEmpty())
+            emit ranksApplied(applied);
+        return;
+    }
+    for (const auto &entry : ranks) {
+        const int row = rowForId(entry.first);
+        const quint64 rank = entry.second;
+        if (row < 0 || !rank || tasks.rank(row) == rank)
+            continue;
+        // 别的行都是排好的，只有这一条换了键：往前或往后找它该在的地方
+        int destination = row;
+        if (row > 0 && rank < tasks.rank(row - 1))
+            destination = rankPosition(rank, 0, row);
+        else if (row + 1 < tasks.size() && rank > tasks.rank(row + 1))
+            destination = rankPosition(rank, row + 1, tasks.size());
+        moveToRank(row, destination, rank);
+    }
+}
+
+void TaskModel::setRanks(int first, const QVector<quint64> &ranks) {
+    if (ranks.isEmpty())
+        return;
+    for (int i = 0; i < ranks.size(); ++i)
+        tasks.setRank(first + i, ranks[i]);
+    emit dataChanged(index(first), index(first + ranks.size() - 1), {RankRole});
+}
+
+void TaskModel::moveToRank(int row, int destination, quint64 rank) {
+    if (destination == row || destination == row + 1) {
+        setRanks(row, {rank});
+        return;
+    }
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+    tasks.setRank(row, rank);
+    tasks.move(row, 1, destination);
+    idToRowDirty = true;
+    endMoveRows();
+}
+
+QVector<quint64> TaskModel::planRanks(int position, const QVector<TaskRecord> &batch) {
+    // 带来的键都有、不减、还夹在前后两行之间，就照用 (读快照、重放日志、按键插入)
+    quint64 previous = position > 0 ? tasks.rank(position - 1) : 0;
+    const quint64 next = position < tasks.size() ? tasks.rank(position) : RANK_MAX;
+    QVector<quint64> ranks;
+    ranks.reserve(batch.size());
+    for (const TaskRecord &task : batch) {
+        if (!task.rank || task.rank < previous || task.rank > next)
+            break;
+        ranks.append(task.rank);
+        previous = task.rank;
+    }
+    if (ranks.size() == batch.size())
+        return ranks;
+    // 带来的键被换掉了，或者流式读旧文件时根本没带，才需要把新键落盘；界面上新建的本来就没有键，不算
+    if (readOnly || std::any_of(batch.cbegin(), batch.cend(), [](const TaskRecord &task) { return task.rank != 0; }))
+        idsReassigned = true;
+    return freshRanks(position, batch.size());
+}
+
+QVector<quint64> TaskModel::freshRanks(int position, int count) {
+    auto low = [&]() { return position > 0 ? tasks.rank(position - 1) : quint64(0); };
+    auto high = [&]() { return position < tasks.size() ? tasks.rank(position) : RANK_MAX; };
+    QVector<quint64> ranks(count);
+    // 追加在末尾：按固定步长往后排，以后插在它们中间的还有地方
+    if (position == tasks.size() && low() <= RANK_MAX - RANK_STEP * quint64(count)) {
+        for (int i = 0; i < count; ++i)
+            ranks[i] = low() + RANK_STEP * quint64(i + 1);
+        return ranks;
+    }
+    // 插在中间：前后两行的键之间平均分，分不开就先把附近拉开
+    if (high() - low() <= quint64(count))
+        spreadRanks(position, count);
+    const quint64 base = low();
+    const quint64 step = (high() - base) / (quint64(count) + 1);
+    for (int i = 0; i < count; ++i)
+        ranks[i] = base + step * quint64(i + 1);
+    return ranks;
+}
+
+void TaskModel::spreadRanks(int position, int count) {
+    TraceSpan span("model.spreadRanks");
+    // 从 position 两边各 8 行开始，范围里的键 (连同要腾出的 count 个) 平均分下来还是太挤，就扩大一倍
+    const int size = tasks.size();
+    int first = 0, last = size;
+    quint64 floor = 0, ceiling = RANK_MAX;
+    for (qint64 half = 8;; half *= 2) {
+        first = static_cast<int>(std::max<qint64>(0, position - half));
+        last = static_cast<int>(std::min<qint64>(size, position + half));
+        floor = first > 0 ? tasks.rank(first - 1) : 0;
+        ceiling = last < size ? tasks.rank(last) : RANK_MAX;
+        const quint64 slots = quint64(last - first) + quint64(count) + 1;
+        if ((ceiling - floor) / slots >= MIN_SPREAD_GAP || (first == 0 && last == size))
+            break;
+    }
+    const quint64 step = (ceiling - floor) / (quint64(last - first) + quint64(count) + 1);
+    QVector<quint64> ranks(last - first);
+    for (int row = first; row < last; ++row)
+        ranks[row - first] = floor + step * quint64(row - first + 1 + (row >= position ? count : 0));
+    setRanks(first, ranks);
+}
+
+int TaskModel::rankPosition(quint64 rank, int from, int to) const {
+    while (from < to) {
+        const int mid = from + (to - from) / 2;
+        if (tasks.rank(mid) <= rank)
+            from = mid + 1;
+        else
+            to = mid;
+    }
+    return from;
+}
+
+void TaskModel::setTasks(const QVector<TaskRecord> &newTasks) {
+    // 先数一下标题总长，arena 一次分配到位
+    qsizetype titleChars = 0;
+    for (const TaskRecord &task : newTasks)
+        titleChars += task.title.size();
+    TaskTable table;
+    table.reserve(newTasks.size(), titleChars);
+    for (const TaskRecord &task : newTasks)
+        table.append(task);
+    setTable(table);
+}
+
+void TaskModel::setTable(const TaskTable &table, QSharedPointer<TaskBinaryFile> mappedFile) {
+    beginResetModel();
+    tasks = table;
+    nextId = 1;
+    idToRow.clear();
+    idToRowDirty = false;
+    idsReassigned = false; // 只管这次加载 (之后界面上新建的任务本来就没有编号)
+    claimIds(0, tasks.size());
+    // 顺序键缺了 (旧文件) 或者乱了 (手改过)：按文件里的先后整个重新发一遍
+    bool ranked = true;
+    for (int row = 0; row < tasks.size() && ranked; ++row)
+        ranked = tasks.rank(row) && (row == 0 || tasks.rank(row - 1) <= tasks.rank(row));
+    if (!ranked) {
+        for (int row = 0; row < tasks.size(); ++row)
+            tasks.setRank(row, RANK_STEP * quint64(row + 1));
+        idsReassigned = true;
+    }
+    mapped = mappedFile;
+    endResetModel();
+}
+
+void TaskModel::materialize() {
+    if (!mapped)
+        return;
+    tasks.materialize(*mapped);
+    mapped.reset();
+}
+
+void TaskModel::setTitle(int row, const QString &newTitle) {
+    if (title(row) == newTitle)
+        return;
+    emit titleAboutToChange(row);
+    // 映射里的行一旦被修改就单独解码出来 (原样日期也要搬出来)，之后不再依赖映射文件
+    if (mapped)
+        tasks.resolve(row, *mapped);
+    tasks.setTitle(row, newTitle);
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {Qt::DisplayRole, Qt::EditRole, TitleRole});
+}
+
+void TaskModel::setDate(int row, const QString &newDate) {
+    if (date(row) == newDate)
+        return;
+    emit dateAboutToChange(row);
+    if (mapped)
+        tasks.resolve(row, *mapped);
+    tasks.setDate(row, newDate);
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {Qt::DisplayRole, DateRole});
+}
+
+void TaskModel::setDone(int row, bool done) {
+    if (tasks.isDone(row) == done)
+        return;
+    tasks.setDone(row, done);
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {Qt::CheckStateRole});
+}
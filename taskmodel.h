@@ -0,0 +1,213 @@
+#ifndef TASKMODEL_H
+#define TASKMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <algorithm>
+#include <utility>
+
+class TaskBinaryFile;
+
+// 一条任务的完整记录：读写文件、日志重放、批量添加时用来进出模型。
+// 模型内部不按这个存 (见 TaskTable)
+struct TaskRecord {
+    quint32 id = 0;     // 文件里带的任务编号，0 = 没有 (旧文件 / 新建的)，进模型时再分配
+    QString title;      // 纯标题
+    QString rawDate;    // 只有日期不是标准 "yyyy-MM-dd" 时才原样保存 (手改过的旧数据)
+    qint32 day = 0;     // 截止日期的儒略日，0 表示没有合法日期
+    bool done = false;  // 是否已完成
+    quint64 rank = 0;   // 顺序键，0 = 没有 (旧文件 / 新建的)，进模型时再发
+
+    void setDate(const QString &text); // 解析 "yyyy-MM-dd"，不合法就原样放进 rawDate
+    QString dateText() const;
+
+    // "yyyy-MM-dd" <-> 儒略日，手写解析，比 QDate::fromString 快得多；不合法时返回 0
+    static qint32 parseDay(QStringView text);
+    static QString formatDay(qint32 day);
+    // 顺序键 <-> 16 位十六进制 (定长，按字符串比较和按数值比较一样)；不合法时返回 0
+    static quint64 parseRank(QStringView text);
+    static QString formatRank(quint64 rank);
+};
+
+// 模型里的一行：固定 24 字节，字符串都不在这里
+struct TaskRow {
+    quint32 id = 0;      // 任务编号，随快照落盘；行号会变，索引里记的是它，文件被外部改了也靠它对上号
+    qint32 day = 0;      // > 0：截止日期的儒略日；0：没有日期；< 0：原样日期，下标是 -day - 1
+    quint32 offset = 0;  // 标题在 arena 里的起点；mapped 时是映射文件里的行号
+    quint32 length : 30; // 标题长度 (UTF-16 码元)
+    quint32 done : 1;
+    quint32 mapped : 1;  // 标题 (和原样日期) 还留在映射的二进制文件里，用到时才解码
+    quint64 rank = 0;    // 顺序键，随快照落盘；表里的行总是按它从小到大排 (可以相等)
+
+    TaskRow() : length(0), done(0), mapped(0) {}
+};
+static_assert(sizeof(TaskRow) == 24, "TaskRow should stay 24 bytes");
+
+// --- 紧凑任务表 ---
+// 所有标题首尾相接放进一个 UTF-16 arena，行里只记偏移和长度；不合法的原样日期很少见，去重后单独放。
+// 比起每条任务一个 QString (头 + 独立的堆块)，百万条能省下一个数量级的内存。
+// 改标题是在 arena 末尾追加新的，旧的成了垃圾，垃圾超过一半时整体压缩一次。
+// 整张表由三个隐式共享的容器组成，整体复制只是加引用计数 (交给工作线程写快照用)。
+class TaskTable {
+  public:
+    int size() const { return rows.size(); }
+    bool isEmpty() const { return rows.isEmpty(); }
+    void reserve(int count, qsizetype titleChars = 0);
+    const TaskRow &row(int i) const { return rows[i]; }
+
+    QStringView title(int i) const; // 映射行返回空
+    // 整块标题 arena：向量化扫描一次读 8 个码元，要知道读到哪里还安全
+    QStringView titleArena() const { return arena; }
+    QString dateText(int i) const;  // 映射行里的原样日期返回空
+    qint32 dueDay(int i) const { return std::max<qint32>(rows[i].day, 0); }
+    bool isDone(int i) const { return rows[i].done; }
+    quint64 rank(int i) const { return rows[i].rank; }
+
+    void append(const TaskRecord &task);
+    void insert(int i, const TaskRecord &task);
+    // 映射行：只有完成标志、儒略日和顺序键，标题留在文件的第 fileRow 条
+    void appendMapped(quint32 id, qint32 day, bool done, quint64 rank, quint32 fileRow);
+    void setTitle(int i, QStringView title);
+    void setDate(int i, const QString &date);
+    void setDone(int i, bool done) { rows[i].done = done; }
+    void setId(int i, quint32 id) { rows[i].id = id; }
+    void setRank(int i, quint64 rank) { rows[i].rank = rank; }
+    void remove(int first, int count);
+    int removeDone(); // 一遍压缩删掉所有已完成的，返回删掉的条数
+    // 语义同 moveRows：把 [first, first + count) 挪到 destination 之前
+    void move(int first, int count, int destination);
+    void sortByRank(); // 按顺序键稳定排序 (键相同的保持原来的先后)
+
+    // 把映射行的字符串解码进 arena
+    void resolve(int i, const TaskBinaryFile &file);
+    void materialize(const TaskBinaryFile &file);
+
+    // 表本身占的字节数 (行 + arena + 原样日期)，不含 QVector/QString 的对象头
+    qsizetype memoryUsage() const;
+
+  private:
+    TaskRow makeRow(const TaskRecord &task);
+    qint32 internRawDate(const QString &text);
+    void appendTitle(TaskRow &r, QStringView title);
+    void dropTitle(const TaskRow &r);
+    void squeeze(); // 重建 arena，扔掉被改掉 / 删掉的标题
+
+    QVector<TaskRow> rows;
+    QString arena;
+    QStringList rawDates;           // 去重后的原样日期
+    QHash<QString, qint32> rawDateIndex;
+    qsizetype garbage = 0;          // arena 里已经没人用的码元数
+};
+
+// --- 任务仓库：给 QListView 用的列表模型 ---
+// 顺序不只靠行号：每条任务有一个 64 位顺序键 (rank)，行总是按键排好。
+// 新键取前后两行的键中间，拖动一条只改它自己的键 (日志、合并、同步都只多一条记录)；
+// 中间挤得没空了才把附近一小段重新拉开 (发一次 RankRole 的 dataChanged)。
+class TaskModel : public QAbstractListModel {
+    Q_OBJECT
+
+  public:
+    // 沿用原来 QListWidgetItem 的约定：UserRole 存纯标题，UserRole + 1 存日期；
+    // IdRole 是任务编号 (过滤代理后面的委托按它缓存排版)；RankRole 是顺序键，只在重新拉开时单独变
+    enum Roles {
+        TitleRole = Qt::UserRole,
+        DateRole = Qt::UserRole + 1,
+        IdRole = Qt::UserRole + 2,
+        RankRole = Qt::UserRole + 3,
+    };
+
+    explicit TaskModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    // 拖拽排序 (InternalMove) 走 moveRows，只搬动受影响的那一段
+    Qt::DropActions supportedDropActions() const override;
+    bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count, const QModelIndex &destinationParent,
+                  int destinationChild) override;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    // 删掉所有已完成的任务，返回删掉的条数。
+    // 连续的一段只删一次 (一条 rowsRemoved、一条日志)；段数太多时改成一遍压缩 + reset，
+    // reset 之前先发 doneAboutToBeCleared (日志记成一行 clear，不用重写快照)
+    int removeDone();
+
+    // 整张表 (写快照时整体复制一份交给工作线程)
+    const TaskTable &table() const { return tasks; }
+    quint32 taskId(int row) const { return tasks.row(row).id; }
+    bool isDone(int row) const { return tasks.isDone(row); }
+    qint32 dueDay(int row) const { return tasks.dueDay(row); } // 没有合法日期时返回 0
+    quint64 rank(int row) const { return tasks.rank(row); }
+    QString title(int row) const;
+    QString date(int row) const;
+    QString displayText(int row) const; // "[日期] 标题"
+    // 按编号找当前行号，找不到返回 -1 (结构变化后第一次查询时才重建对照表)
+    int rowForId(quint32 id) const;
+
+    void appendTask(const TaskRecord &task);
+    // 一批只发一次 rowsInserted。带来的顺序键夹得进前后两行之间就照用 (读快照、重放日志)，否则整批现发
+    void appendTasks(const QVector<TaskRecord> &batch);
+    void insertTask(int row, const TaskRecord &task);
+    void insertTasks(int row, const QVector<TaskRecord> &batch); // 插在 row 之前，其余同上
+    // 按各自带的顺序键插到该在的位置 (合并外部改动、同步用)，没带键的放到最后
+    void insertRanked(const QVector<TaskRecord> &batch);
+    // 改这些任务 (编号 -> 新键) 的顺序键并挪到键对应的位置：条数少时逐条挪，
+    // 多了整表按键重排一次 (一次 layoutChanged，选中项跟着任务走，然后发 ranksApplied)
+    void applyRanks(const QVector<QPair<quint32, quint64>> &ranks);
+    // 原样改掉 [first, first + ranks.size()) 的顺序键，调用方保证改完顺序不乱 (重放日志用)
+    void setRanks(int first, const QVector<quint64> &ranks);
+    // 整体替换 (加载时一次性 reset)；mapped 不为空时，部分行的字符串还在映射文件里
+    void setTasks(const QVector<TaskRecord> &newTasks);
+    void setTable(const TaskTable &table, QSharedPointer<TaskBinaryFile> mapped = {});
+    bool isMapped() const { return !mapped.isNull(); }
+    // 把还在映射文件里的记录全部解码出来并释放映射 (写新快照前调用)
+    void materialize();
+    void setTitle(int row, const QString &title);
+    void setDone(int row, bool done);
+    void setDate(int row, const QString &date);
+    // 任务本身占的内存 (表 + 编号对照表)，用来核对每条任务的字节数
+    qsizetype memoryUsage() const;
+
+    // 只读时界面上不能勾选、拖动 (流式加载期间用)
+    void setReadOnly(bool on) { readOnly = on; }
+    bool isReadOnly() const { return readOnly; }
+
+    // 上次 setTable / setTasks 以来，有没有行没带来能用的编号 (旧文件没有编号、撞号、大得离谱) 或顺序键而被发了新的；
+    // 加载完发现有，就该尽快写一份新快照把编号和顺序键落盘。读完清零
+    bool takeIdsReassigned() { return std::exchange(idsReassigned, false); }
+
+  signals:
+    // 标题即将被改掉 (旧标题此时还能读到)，搜索索引靠它撤掉旧词条
+    void titleAboutToChange(int row);
+    void dateAboutToChange(int row); // 同上，改截止日期之前
+    // applyRanks 整表重排过：真正换了键的任务 (编号 -> 新键)，日志记成一行、同步标成待发
+    void ranksApplied(const QVector<QPair<quint32, quint64>> &ranks);
+    // removeDone 要整表压缩了 (紧接着是一次 reset)
+    void doneAboutToBeCleared();
+
+  private:
+    void prepareIdLookup(const QVector<TaskRecord> &batch) const;
+    void claimIds(int first, int count);
+    // 插在 position 之前的 batch 用哪些顺序键 (可能先把附近重新拉开)
+    QVector<quint64> planRanks(int position, const QVector<TaskRecord> &batch);
+    QVector<quint64> freshRanks(int position, int count);
+    void spreadRanks(int position, int count); // 给 position 之前腾出 count 个键的空
+    int rankPosition(quint64 rank, int from, int to) const; // [from, to) 里第一个键比 rank 大的行
+    void moveToRank(int row, int destination, quint64 rank); // 只挪一行 (destination 同 moveRows)，顺便换键
+
+    TaskTable tasks;
+    bool readOnly = false;
+    QSharedPointer<TaskBinaryFile> mapped;
+    quint32 nextId = 1;
+    mutable QVector<int> idToRow; // 下标是编号
+    mutable bool idToRowDirty = true;
+    bool idsReassigned = false;
+};
+
+#endif // TASKMODEL_H
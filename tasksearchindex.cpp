@@ -0,0 +1,161 @@
+#include "tasksearchindex.h"
+#include "tracer.h"
+#include <algorithm>
+
+TaskSearchIndex::TaskSearchIndex(TaskModel *model, QObject *parent) : QObject(parent), model(model) {
+    // 还没建好时什么都不用跟，第一次搜索会整体建立
+    connect(model, &TaskModel::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        if (built)
+            for (int row = first; row <= last; ++row)
+                addRow(row);
+    });
+    connect(model, &TaskModel::rowsAboutToBeRemoved, this, [this](const QModelIndex &, int first, int last) {
+        if (built)
+            for (int row = first; row <= last; ++row)
+                removeRow(row);
+    });
+    // 日期也在被索引的文字里，改日期和改标题一样处理
+    auto aboutToChange = [this](int row) {
+        if (built)
+            removeRow(row);
+    };
+    connect(model, &TaskModel::titleAboutToChange, this, aboutToChange);
+    connect(model, &TaskModel::dateAboutToChange, this, aboutToChange);
+    connect(model, &TaskModel::dataChanged, this,
+            [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+                if (built && (roles.contains(TaskModel::TitleRole) || roles.contains(TaskModel::DateRole)))
+                    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+                        addRow(row);
+            });
+    // 整体替换 (加载) 后作废，下次搜索再建；拖动排序不改编号，不用管
+    connect(model, &TaskModel::modelReset, this, [this]() {
+        built = false;
+        unigrams.clear();
+        bigrams.clear();
+    });
+}
+
+QString TaskSearchIndex::foldedText(int row) const {
+    // 日期和标题之间用换行隔开：输入框里打不出换行，不会拼出跨两段的假命中
+    return (model->date(row) + QLatin1Char('\n') + model->title(row)).toCaseFolded();
+}
+
+void TaskSearchIndex::collectGrams(const QString &text, QVector<quint32> &unigramKeys,
+                                   QVector<quint32> &bigramKeys) {
+    const char16_t *s = reinterpret_cast<const char16_t *>(text.utf16());
+    const qsizetype n = text.size();
+    unigramKeys.clear();
+    bigramKeys.clear();
+    for (qsizetype i = 0; i < n; ++i) {
+        unigramKeys.append(s[i]);
+        if (i + 1 < n)
+            bigramKeys.append((quint32(s[i]) << 16) | s[i + 1]);
+    }
+    std::sort(unigramKeys.begin(), unigramKeys.end());
+    unigramKeys.erase(std::unique(unigramKeys.begin(), unigramKeys.end()), unigramKeys.end());
+    std::sort(bigramKeys.begin(), bigramKeys.end());
+    bigramKeys.erase(std::unique(bigramKeys.begin(), bigramKeys.end()), bigramKeys.end());
+}
+
+void TaskSearchIndex::insertId(QVector<quint32> &list, quint32 id) {
+    // 新任务的编号总是最大的，绝大多数情况直接追加在末尾
+    if (list.isEmpty() || list.last() < id) {
+        list.append(id);
+        return;
+    }
+    auto it = std::lower_bound(list.begin(), list.end(), id);
+    if (it == list.end() || *it != id)
+        list.insert(it, id);
+}
+
+void TaskSearchIndex::eraseId(Postings &postings, quint32 key, quint32 id) {
+    auto entry = postings.find(key);
+    if (entry == postings.end())
+        return;
+    QVector<quint32> &list = entry.value();
+    auto it = std::lower_bound(list.begin(), list.end(), id);
+    if (it != list.end() && *it == id)
+        list.erase(it);
+    if (list.isEmpty())
+        postings.erase(entry);
+}
+
+void TaskSearchIndex::addRow(int row) {
+    const quint32 id = model->taskId(row);
+    QVector<quint32> uni, bi;
+    collectGrams(foldedText(row), uni, bi);
+    for (quint32 key : uni)
+        insertId(unigrams[key], id);
+    for (quint32 key : bi)
+        insertId(bigrams[key], id);
+}
+
+void TaskSearchIndex::removeRow(int row) {
+    const quint32 id = model->taskId(row);
+    QVector<quint32> uni, bi;
+    collectGrams(foldedText(row), uni, bi);
+    for (quint32 key : uni)
+        eraseId(unigrams, key, id);
+    for (quint32 key : bi)
+        eraseId(bigrams, key, id);
+}
+
+void TaskSearchIndex::ensureBuilt() {
+    if (built)
+        return;
+    // 按编号从小到大加入，每张表都只在末尾追加
+    QVector<QPair<quint32, int>> order;
+    order.reserve(model->rowCount());
+    for (int row = 0; row < model->rowCount(); ++row)
+        order.append({model->taskId(row), row});
+    std::sort(order.begin(), order.end());
+    for (const auto &entry : order)
+        addRow(entry.second);
+    built = true;
+}
+
+QVector<quint32> TaskSearchIndex::search(const QString &text) {
+    TraceSpan span("search.index");
+    const QString needle = text.toCaseFolded();
+    if (needle.isEmpty())
+        return {};
+    ensureBuilt();
+
+    QVector<quint32> uni, bi;
+    collectGrams(needle, uni, bi);
+    // 单个字符：表里的就是准确答案
+    if (needle.size() == 1)
+        return unigrams.value(uni.first());
+
+    // 从最短的表开始求交集，后面的表只做二分查找
+    QVector<const QVector<quint32> *> lists;
+    for (quint32 key : bi) {
+        auto it = bigrams.constFind(key);
+        if (it == bigrams.constEnd())
+            return {};
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const QVector<quint32> *a, const QVector<quint32> *b) { return a->size() < b->size(); });
+
+    QVector<quint32> result = *lists.first();
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        const QVector<quint32> &other = *lists[i];
+        result.erase(std::remove_if(result.begin(), result.end(),
+                                    [&](quint32 id) {
+                                        return !std::binary_search(other.begin(), other.end(), id);
+                                    }),
+                     result.end());
+    }
+    if (needle.size() == 2)
+        return result;
+
+    // 三个字以上：词条都在不代表连在一起，逐条核对原文
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [&](quint32 id) {
+                                    const int row = model->rowForId(id);
+                                    return row < 0 || !foldedText(row).contains(needle);
+                                }),
+                 result.end());
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef TASKSEARCHINDEX_H
+#define TASKSEARCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "taskmodel.h"
+
+// --- 搜索用的倒排索引 ---
+// 把 "[日期] 标题" 做大小写折叠后切成单字和相邻两字 (中文词多是两个字，比三字组更合适)，
+// 每个词条对应一张按编号排好序的任务表。搜索时只在最短的那几张表里求交集，
+// 再逐条核对原文，所以每次按键的开销跟命中条数有关，跟列表总长度无关。
+// 跟着模型的信号增量更新；第一次搜索前才整体建立，免得拖慢启动。
+class TaskSearchIndex : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit TaskSearchIndex(TaskModel *model, QObject *parent = nullptr);
+
+    // 返回包含 text 的任务编号 (不分大小写)，text 为空时返回空表
+    QVector<quint32> search(const QString &text);
+
+  private:
+    using Postings = QHash<quint32, QVector<quint32>>;
+
+    void ensureBuilt();
+    void addRow(int row);
+    void removeRow(int row);
+    QString foldedText(int row) const;
+
+    // 把 text 拆成去重后的单字 / 两字词条
+    static void collectGrams(const QString &text, QVector<quint32> &unigramKeys, QVector<quint32> &bigramKeys);
+    static void insertId(QVector<quint32> &list, quint32 id);
+    static void eraseId(Postings &postings, quint32 key, quint32 id);
+
+    TaskModel *model;
+    bool built = false;
+    Postings unigrams; // 单个 UTF-16 码元 -> 任务编号
+    Postings bigrams;  // 两个相邻码元拼成的 32 位键 -> 任务编号
+};
+
+#endif // TASKSEARCHINDEX_H
@@ -0,0 +1,217 @@
+#include "themeengine.h"
+#include <QAbstractItemView>
+#include <QApplication>
+#include <QPainter>
+#include <QPointer>
+#include <QProxyStyle>
+#include <QPushButton>
+#include <QStyleFactory>
+#include <QStyleOption>
+
+namespace {
+
+// 原来各处 CSS 里的圆角和内边距，在这里统一成常量
+const qreal BUTTON_RADIUS = 6;
+const qreal LINE_EDIT_RADIUS = 8;
+const qreal ITEM_RADIUS = 4;
+const qreal FRAME_RADIUS = 6;
+const int ITEM_PADDING = 8;
+
+// 所有圆角矩形都画在半像素上，1px 的边框才不会发虚
+void fillRounded(QPainter *p, const QRect &rect, qreal radius, const QColor &fill, const QColor &border) {
+    p->save();
+    p->setRenderHint(QPainter::Antialiasing);
+    p->setPen(border.isValid() ? QPen(border, 1) : QPen(Qt::NoPen));
+    p->setBrush(fill.isValid() ? QBrush(fill) : QBrush(Qt::NoBrush));
+    p->drawRoundedRect(QRectF(rect).adjusted(0.5, 0.5, -0.5, -0.5), radius, radius);
+    p->restore();
+}
+
+bool isAccent(const QWidget *widget) {
+    return widget && widget->property("accent").toBool();
+}
+
+class ThemeStyle : public QProxyStyle {
+  public:
+    explicit ThemeStyle(const ThemeEngine *engine) : QProxyStyle(QStyleFactory::create("Fusion")), engine(engine) {
+    }
+
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                       const QWidget *widget) const override {
+        if (!engine) {
+            QProxyStyle::drawPrimitive(element, option, painter, widget);
+            return;
+        }
+        const ThemeEngine::Theme &t = engine->current();
+        const bool hover = option->state & State_MouseOver;
+        const bool pressed = option->state & (State_Sunken | State_On);
+
+        switch (element) {
+        case PE_PanelButtonCommand: {
+            if (isAccent(widget)) {
+                const QColor fill = pressed ? t.accentPressed : hover ? t.accentHover : t.accent;
+                fillRounded(painter, option->rect, BUTTON_RADIUS, fill, QColor());
+            } else {
+                const QColor fill = pressed ? t.buttonPressed : hover ? t.buttonHover
+                                                                      : option->palette.color(QPalette::Button);
+                fillRounded(painter, option->rect, BUTTON_RADIUS, fill, t.border);
+            }
+            return;
+        }
+        case PE_PanelLineEdit:
+            fillRounded(painter, option->rect, LINE_EDIT_RADIUS, option->palette.color(QPalette::Base), QColor());
+            if (const auto *frame = qstyleoption_cast<const QStyleOptionFrame *>(option); frame && frame->lineWidth > 0)
+                drawPrimitive(PE_FrameLineEdit, option, painter, widget);
+            return;
+        case PE_FrameLineEdit:
+            fillRounded(painter, option->rect, LINE_EDIT_RADIUS, QColor(),
+                        (option->state & State_HasFocus) ? t.focusBorder : t.border);
+            return;
+        case PE_Frame:
+            fillRounded(painter, option->rect, FRAME_RADIUS, QColor(), t.border);
+            return;
+        case PE_PanelItemViewItem: {
+            const QRect r = option->rect;
+            if (option->state & State_Selected)
+                fillRounded(painter, r, ITEM_RADIUS, option->palette.color(QPalette::Highlight), QColor());
+            else if (hover)
+                fillRounded(painter, r, ITEM_RADIUS, t.itemHover, QColor());
+            painter->save();
+            painter->setPen(t.itemSeparator);
+            painter->drawLine(r.left(), r.bottom(), r.right(), r.bottom());
+            painter->restore();
+            return;
+        }
+        case PE_FrameFocusRect:
+            // 列表里不画虚线焦点框 (原来 CSS 的 outline: none)
+            if (qobject_cast<const QAbstractItemView *>(widget))
+                return;
+            break;
+        default:
+            break;
+        }
+        QProxyStyle::drawPrimitive(element, option, painter, widget);
+    }
+
+    void drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                     const QWidget *widget) const override {
+        if (element == CE_PushButtonLabel && engine) {
+            if (const auto *button = qstyleoption_cast<const QStyleOptionButton *>(option)) {
+                // 主按钮用白字；扁平按钮 (主题切换) 悬停时文字变成强调色
+                const ThemeEngine::Theme &t = engine->current();
+                QStyleOptionButton copy(*button);
+                if (isAccent(widget))
+                    copy.palette.setColor(QPalette::ButtonText, Qt::white);
+                else if ((button->features & QStyleOptionButton::Flat) && (button->state & State_MouseOver))
+                    copy.palette.setColor(QPalette::ButtonText, t.accent);
+                QProxyStyle::drawControl(element, &copy, painter, widget);
+                return;
+            }
+        }
+        QProxyStyle::drawControl(element, option, painter, widget);
+    }
+
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                           const QWidget *widget) const override {
+        QSize s = QProxyStyle::sizeFromContents(type, option, size, widget);
+        // 列表项上下各留一点空 (原来 CSS 的 padding)
+        if (type == CT_ItemViewItem)
+            s.rheight() += 2 * ITEM_PADDING;
+        return s;
+    }
+
+    QPalette standardPalette() const override {
+        return engine ? engine->current().palette : QProxyStyle::standardPalette();
+    }
+
+  private:
+    // 样式归 QApplication 所有，可能比主窗口 (以及引擎) 活得久
+    QPointer<const ThemeEngine> engine;
+};
+
+ThemeEngine::Theme makeLight() {
+    ThemeEngine::Theme t;
+    QPalette &p = t.palette;
+    p.setColor(QPalette::Window, QColor("#f5f7fa"));
+    p.setColor(QPalette::WindowText, QColor("#333333"));
+    p.setColor(QPalette::Base, Qt::white);
+    p.setColor(QPalette::AlternateBase, QColor("#f5f7fa"));
+    p.setColor(QPalette::Text, QColor("#333333"));
+    p.setColor(QPalette::PlaceholderText, QColor("#888888"));
+    p.setColor(QPalette::Button, QColor("#f0f0f0"));
+    p.setColor(QPalette::ButtonText, QColor("#333333"));
+    p.setColor(QPalette::Highlight, QColor("#e6f2ff"));
+    p.setColor(QPalette::HighlightedText, QColor("#007ACC"));
+    p.setColor(QPalette::ToolTipBase, Qt::white);
+    p.setColor(QPalette::ToolTipText, QColor("#333333"));
+    p.setColor(QPalette::Link, QColor("#007ACC"));
+    p.setColor(QPalette::Light, Qt::white);
+    p.setColor(QPalette::Midlight, QColor("#eeeeee"));
+    p.setColor(QPalette::Mid, QColor("#cccccc"));
+    p.setColor(QPalette::Dark, QColor("#bbbbbb"));
+    p.setColor(QPalette::Disabled, QPalette::Text, QColor("#aaaaaa"));
+    p.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#aaaaaa"));
+    p.setColor(QPalette::Disabled, QPalette::WindowText, QColor("#aaaaaa"));
+
+    t.accent = QColor("#007ACC");
+    t.accentHover = QColor("#0062a3");
+    t.accentPressed = QColor("#004472");
+    t.buttonHover = QColor("#e6e6e6");
+    t.buttonPressed = QColor("#dcdcdc");
+    t.border = QColor("#cccccc");
+    t.focusBorder = QColor("#007ACC");
+    t.itemHover = QColor("#f5f7fa");
+    t.itemSeparator = QColor("#f0f0f0");
+    return t;
+}
+
+ThemeEngine::Theme makeDark() {
+    ThemeEngine::Theme t;
+    QPalette &p = t.palette;
+    p.setColor(QPalette::Window, QColor("#2b2b2b"));
+    p.setColor(QPalette::WindowText, QColor("#e0e0e0"));
+    p.setColor(QPalette::Base, QColor("#3c3f41"));
+    p.setColor(QPalette::AlternateBase, QColor("#45494a"));
+    p.setColor(QPalette::Text, QColor("#e0e0e0"));
+    p.setColor(QPalette::PlaceholderText, QColor("#999999"));
+    p.setColor(QPalette::Button, QColor("#3c3f41"));
+    p.setColor(QPalette::ButtonText, QColor("#e0e0e0"));
+    p.setColor(QPalette::Highlight, QColor("#4b6eaf"));
+    p.setColor(QPalette::HighlightedText, Qt::white);
+    p.setColor(QPalette::ToolTipBase, QColor("#3c3f41"));
+    p.setColor(QPalette::ToolTipText, QColor("#e0e0e0"));
+    p.setColor(QPalette::Link, QColor("#6897bb"));
+    p.setColor(QPalette::Light, QColor("#505354"));
+    p.setColor(QPalette::Midlight, QColor("#4a4a4a"));
+    p.setColor(QPalette::Mid, QColor("#555555"));
+    p.setColor(QPalette::Dark, QColor("#232323"));
+    p.setColor(QPalette::Disabled, QPalette::Text, QColor("#777777"));
+    p.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#777777"));
+    p.setColor(QPalette::Disabled, QPalette::WindowText, QColor("#777777"));
+
+    t.accent = QColor("#365880");
+    t.accentHover = QColor("#4b6eaf");
+    t.accentPressed = QColor("#2c4766");
+    t.buttonHover = QColor("#4a4d4f");
+    t.buttonPressed = QColor("#323436");
+    t.border = QColor("#555555");
+    t.focusBorder = QColor("#4b6eaf");
+    t.itemHover = QColor("#45494a");
+    t.itemSeparator = QColor("#4a4a4a");
+    return t;
+}
+
+} // namespace
+
+ThemeEngine::ThemeEngine(QObject *parent) : QObject(parent), light(makeLight()), dark(makeDark()) {
+    // 样式只装这一次；之后切主题不再动它
+    qApp->setStyle(new ThemeStyle(this));
+    QApplication::setPalette(light.palette);
+}
+
+void ThemeEngine::apply(Mode mode) {
+    if (mode == currentMode)
+        return;
+    currentMode = mode;
+    QApplication::setPalette(current().palette);
+}
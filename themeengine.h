@@ -0,0 +1,46 @@
+#ifndef THEMEENGINE_H
+#define THEMEENGINE_H
+
+#include <QColor>
+#include <QObject>
+#include <QPalette>
+
+// --- 主题引擎 ---
+// 启动时把亮色 / 暗色两套 QPalette 和绘制用的颜色一次性准备好，
+// 再给整个程序装一个基于 Fusion 的 QProxyStyle，圆角按钮、输入框、列表项都由它按当前主题画。
+// 切换主题只是 QApplication::setPalette：不解析任何 CSS，不重新 polish 控件，
+// 各控件收到调色板变化后自己 update()，只有看得见的部分会重绘。
+class ThemeEngine : public QObject {
+    Q_OBJECT
+
+  public:
+    enum Mode { Light, Dark };
+
+    // 一套主题里调色板表达不了的颜色 (强调色的各种状态、边框、分隔线...)
+    struct Theme {
+        QPalette palette;
+        QColor accent;         // 主按钮 (setProperty("accent", true))
+        QColor accentHover;
+        QColor accentPressed;
+        QColor buttonHover;    // 普通按钮
+        QColor buttonPressed;
+        QColor border;         // 输入框、列表、按钮的边框
+        QColor focusBorder;    // 输入框有焦点时
+        QColor itemHover;      // 列表项悬停
+        QColor itemSeparator;  // 列表项之间的分隔线
+    };
+
+    // 会把自己的样式装到 qApp 上 (QApplication 接管样式对象)
+    explicit ThemeEngine(QObject *parent = nullptr);
+
+    void apply(Mode mode);
+    Mode mode() const { return currentMode; }
+    const Theme &current() const { return currentMode == Dark ? dark : light; }
+
+  private:
+    Theme light;
+    Theme dark;
+    Mode currentMode = Light;
+};
+
+#endif // THEMEENGINE_H
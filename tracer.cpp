@@ -0,0 +1,192 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QSaveFile>
+#include <QSettings>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+std::atomic<bool> Tracer::enabledFlag{false};
+
+namespace {
+
+const int DEFAULT_CAPACITY = 1 << 16;
+
+// 一个槽位。字段都是原子的 (relaxed)，导出线程和写入线程同时碰它也不算数据竞争；
+// seq = 记录序号 + 1，写完最后才更新，导出时前后各读一次，对不上就说明正被覆盖
+struct Slot {
+    std::atomic<quint64> seq{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> start{0};
+    std::atomic<qint64> duration{0};
+    std::atomic<quint32> thread{0};
+};
+
+Slot *slots = nullptr;
+quint64 slotMask = 0;
+std::atomic<quint64> head{0};
+std::atomic<quint32> threadCounter{0};
+QString tracePath;
+
+quint32 currentThread() {
+    thread_local quint32 id = threadCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+    return id;
+}
+
+std::chrono::steady_clock::time_point origin() {
+    static const std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+    return t;
+}
+
+void appendJsonString(QByteArray &out, const char *text) {
+    out += '"';
+    for (const char *p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\')
+            out += '\\';
+        out += *p;
+    }
+    out += '"';
+}
+
+} // namespace
+
+void Tracer::setupFromEnvironment() {
+    const QByteArray env = qgetenv("ZTD_TRACE");
+    QSettings settings("MySoft", "ToDoList");
+    const bool fromEnv = !env.isEmpty() && env != "0";
+    if (!fromEnv && !settings.value("trace", false).toBool())
+        return;
+    // ZTD_TRACE 不是 1 的时候当成输出路径
+    if (fromEnv && env != "1")
+        tracePath = QString::fromLocal8Bit(env);
+    else
+        tracePath = QCoreApplication::applicationDirPath() + "/ztd-trace.json";
+    enable(settings.value("traceBufferSize", DEFAULT_CAPACITY).toInt());
+}
+
+void Tracer::enable(int capacity) {
+    if (isEnabled())
+        return;
+    // 容量取 2 的幂，槽位下标用掩码算
+    quint64 size = 1024;
+    while (size < static_cast<quint64>(std::max(capacity, 1)))
+        size <<= 1;
+    slots = new Slot[size]; // 跟进程同寿，不释放
+    slotMask = size - 1;
+    origin();
+    enabledFlag.store(true, std::memory_order_release);
+}
+
+qint64 Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin()).count();
+}
+
+void Tracer::record(const char *name, qint64 start, qint64 end) {
+    if (!isEnabled())
+        return;
+    const quint64 n = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[n & slotMask];
+    slot.seq.store(0, std::memory_order_relaxed); // 先标成"正在写"
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(end - start, std::memory_order_relaxed);
+    slot.thread.store(currentThread(), std::memory_order_relaxed);
+    slot.seq.store(n + 1, std::memory_order_release);
+}
+
+QVector<Tracer::Event> Tracer::events() {
+    QVector<Event> result;
+    if (!isEnabled())
+        return result;
+    const quint64 end = head.load(std::memory_order_acquire);
+    const quint64 capacity = slotMask + 1;
+    const quint64 begin = end > capacity ? end - capacity : 0;
+    result.reserve(static_cast<qsizetype>(end - begin));
+    for (quint64 n = begin; n < end; ++n) {
+        const Slot &slot = slots[n & slotMask];
+        if (slot.seq.load(std::memory_order_acquire) != n + 1)
+            continue; // 还没写完，或者已经被更新的记录覆盖
+        Event e;
+        e.name = slot.name.load(std::memory_order_relaxed);
+        e.start = slot.start.load(std::memory_order_relaxed);
+        e.duration = slot.duration.load(std::memory_order_relaxed);
+        e.thread = slot.thread.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == n + 1 && e.name)
+            result.append(e);
+    }
+    return result;
+}
+
+QString Tracer::outputPath() {
+    return tracePath;
+}
+
+bool Tracer::exportChromeTrace(const QString &path) {
+    const QVector<Event> all = events();
+    // Trace Event Format：完整事件 "ph":"X"，时间单位是微秒
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out.reserve(all.size() * 96 + 64);
+    for (int i = 0; i < all.size(); ++i) {
+        const Event &e = all[i];
+        if (i)
+            out += ",\n";
+        out += "{\"name\":";
+        appendJsonString(out, e.name);
+        out += ",\"cat\":\"ztd\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(e.thread);
+        out += ",\"ts\":" + QByteArray::number(e.start / 1000.0, 'f', 3);
+        out += ",\"dur\":" + QByteArray::number(e.duration / 1000.0, 'f', 3) + "}";
+    }
+    out += "\n]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(out);
+    return file.commit();
+}
+
+QString Tracer::summary() {
+    QHash<QByteArray, QVector<qint64>> byName;
+    for (const Event &e : events())
+        byName[QByteArray(e.name)].append(e.duration);
+
+    QList<QByteArray> names = byName.keys();
+    std::sort(names.begin(), names.end());
+    auto ms = [](qint64 ns) { return QString::number(ns / 1e6, 'f', 3); };
+    QString text = QString("%1 %2 %3 %4 %5\n")
+                       .arg("span", -28)
+                       .arg("count", 8)
+                       .arg("p50 ms", 10)
+                       .arg("p99 ms", 10)
+                       .arg("max ms", 10);
+    for (const QByteArray &name : names) {
+        QVector<qint64> &d = byName[name];
+        std::sort(d.begin(), d.end());
+        // 最近秩法：第 ceil(p * n) 小的那个
+        auto percentile = [&](double p) { return d[std::max<qsizetype>(0, qsizetype(std::ceil(p * d.size())) - 1)]; };
+        text += QString("%1 %2 %3 %4 %5\n")
+                    .arg(QString::fromLatin1(name), -28)
+                    .arg(d.size(), 8)
+                    .arg(ms(percentile(0.5)), 10)
+                    .arg(ms(percentile(0.99)), 10)
+                    .arg(ms(d.last()), 10);
+    }
+    return text;
+}
+
+bool Tracer::exportAll() {
+    if (!isEnabled() || tracePath.isEmpty())
+        return false;
+    const QString text = summary();
+    QSaveFile file(tracePath + ".summary.txt");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(text.toUtf8());
+        file.commit();
+    }
+    qInfo().noquote() << "Z-Td: trace written to" << tracePath << "\n" << text;
+    return exportChromeTrace(tracePath);
+}
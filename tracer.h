@@ -0,0 +1,58 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+// --- 内置性能跟踪 ---
+// 热点路径上放一个 TraceSpan，析构时把 (名字, 起点, 时长, 线程) 写进一个固定大小的环形缓冲区。
+// 写入不加锁：每条记录用 fetch_add 抢一个槽位，槽位上的序号保证导出时不会读到写了一半的记录；
+// 缓冲区满了就覆盖最旧的。没开跟踪时 TraceSpan 只读一次原子标志，几乎没有开销。
+// 打开方式：环境变量 ZTD_TRACE=1 (或 =输出文件路径)，或设置里 trace=true。
+// 退出时导出成 Chrome / Perfetto 能直接打开的 trace JSON，旁边再写一份 p50/p99 汇总。
+class Tracer {
+  public:
+    struct Event {
+        const char *name; // 必须是字符串字面量 (只存指针)
+        qint64 start;     // 纳秒，从进程里第一次取时间算起
+        qint64 duration;
+        quint32 thread;   // 线程序号 (第一个记录的线程是 1)
+    };
+
+    static bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+    // 按环境变量和设置决定要不要打开 (程序启动时调一次)
+    static void setupFromEnvironment();
+    static void enable(int capacity);
+    static qint64 now();
+    // 跨越多轮事件循环的区间 (网络往返、流式加载) 自己记起点，结束时调这个
+    static void record(const char *name, qint64 start, qint64 end);
+
+    static QVector<Event> events(); // 缓冲区里现有的记录，从旧到新
+    static QString outputPath();
+    static bool exportChromeTrace(const QString &path);
+    static QString summary(); // 每个名字的次数、p50、p99、最大值
+    // 导出 trace 和汇总 (path + ".summary.txt")，没打开跟踪时什么都不做
+    static bool exportAll();
+
+  private:
+    static std::atomic<bool> enabledFlag;
+};
+
+// 作用域计时：构造时记起点，析构时写一条记录
+class TraceSpan {
+  public:
+    explicit TraceSpan(const char *name) : name(name), start(Tracer::isEnabled() ? Tracer::now() : -1) {}
+    ~TraceSpan() {
+        if (start >= 0)
+            Tracer::record(name, start, Tracer::now());
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+  private:
+    const char *name;
+    qint64 start;
+};
+
+#endif // TRACER_H
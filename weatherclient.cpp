@@ -0,0 +1,187 @@
+#include "weatherclient.h"
+#include "tracer.h"
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkDiskCache>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QUrlQuery>
+
+static const char *DEFAULT_BASE_URL = "https://api.open-meteo.com/v1/forecast";
+static const int RETRY_BASE_MS = 30 * 1000;
+static const int RETRY_MAX_MS = 3600 * 1000;
+static const qint64 HTTP_CACHE_SIZE = 2 * 1024 * 1024;
+static const int FORECAST_DAYS = 16;   // Open-Meteo 免费接口最多 16 天
+static const int KEEP_PAST_DAYS = 7;   // 过去的预报留一周 (刚过期的任务还能看)
+
+WeatherClient::WeatherClient(QObject *parent) : QObject(parent) {
+    net = new QNetworkAccessManager(this);
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QNetworkDiskCache *cache = new QNetworkDiskCache(this);
+    cache->setCacheDirectory(cacheDir + "/http");
+    cache->setMaximumCacheSize(HTTP_CACHE_SIZE);
+    net->setCache(cache);
+    QDir().mkpath(cacheDir);
+    lastResponsePath = cacheDir + "/weather_last.json";
+
+    retryTimer = new QTimer(this);
+    retryTimer->setSingleShot(true);
+    retryTimer->setTimerType(Qt::VeryCoarseTimer);
+    connect(retryTimer, &QTimer::timeout, this, &WeatherClient::fetch);
+
+    QSettings settings("MySoft", "ToDoList");
+    baseUrl = settings.value("weatherBaseUrl", DEFAULT_BASE_URL).toString();
+    loadLocations();
+
+    // 上次成功的响应：启动时先拿它顶上 (坐标改过的话地点对不上，就不用了)
+    QFile saved(lastResponsePath);
+    if (saved.open(QIODevice::ReadOnly))
+        apply(saved.readAll(), QFileInfo(saved).lastModified());
+}
+
+void WeatherClient::loadLocations() {
+    QSettings settings("MySoft", "ToDoList");
+    const QStringList entries = settings.value("weatherLocations").toStringList();
+    for (const QString &entry : entries) {
+        const QStringList parts = entry.split(',');
+        bool latOk = false, lonOk = false;
+        WeatherLocation loc;
+        if (parts.size() == 3) {
+            loc.name = parts[0].trimmed();
+            loc.latitude = parts[1].toDouble(&latOk);
+            loc.longitude = parts[2].toDouble(&lonOk);
+        }
+        if (latOk && lonOk)
+            locations.append(loc);
+    }
+    // 没配置时沿用原来的单个坐标
+    if (locations.isEmpty()) {
+        WeatherLocation loc;
+        loc.name = "本地";
+        loc.latitude = settings.value("weatherLatitude", 23.02).toDouble();
+        loc.longitude = settings.value("weatherLongitude", 113.23).toDouble();
+        locations.append(loc);
+    }
+    daily.resize(locations.size());
+}
+
+QUrl WeatherClient::requestUrl() const {
+    QStringList lats, lons;
+    for (const WeatherLocation &loc : locations) {
+        lats.append(QString::number(loc.latitude));
+        lons.append(QString::number(loc.longitude));
+    }
+    QUrl url(baseUrl);
+    QUrlQuery query;
+    query.addQueryItem("latitude", lats.join(','));
+    query.addQueryItem("longitude", lons.join(','));
+    query.addQueryItem("current_weather", "true");
+    query.addQueryItem("daily", "weathercode,temperature_2m_max,temperature_2m_min");
+    query.addQueryItem("forecast_days", QString::number(FORECAST_DAYS));
+    query.addQueryItem("timezone", "auto");
+    url.setQuery(query);
+    return url;
+}
+
+bool WeatherClient::forecast(int location, qint32 day, DailyForecast *out) const {
+    if (location < 0 || location >= daily.size())
+        return false;
+    auto it = daily[location].constFind(day);
+    if (it == daily[location].constEnd())
+        return false;
+    *out = it.value();
+    return true;
+}
+
+void WeatherClient::fetch() {
+    if (inFlight)
+        return; // 上一个请求还没回来
+    retryTimer->stop();
+    retryPending = false;
+
+    QNetworkRequest request(requestUrl());
+    // PreferNetwork：缓存新鲜就直接用，过期了发条件请求 (服务器回 304 时照样从缓存取)
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+    fetchStarted = Tracer::isEnabled() ? Tracer::now() : -1;
+    inFlight = net->get(request);
+    connect(inFlight, &QNetworkReply::finished, this, [this, reply = inFlight]() { onFinished(reply); });
+}
+
+bool WeatherClient::apply(const QByteArray &body, const QDateTime &fetchedAt) {
+    const QVector<LocationForecast> parsed = WeatherParser::parse(body, fetchedAt);
+    if (parsed.size() != locations.size() || !parsed.first().current.isValid())
+        return false;
+
+    // 新的预报按天合并进去，太久以前的扔掉
+    const qint32 oldest = static_cast<qint32>(QDate::currentDate().toJulianDay()) - KEEP_PAST_DAYS;
+    for (int i = 0; i < parsed.size(); ++i) {
+        QMap<qint32, DailyForecast> &days = daily[i];
+        for (const DailyForecast &f : parsed[i].daily)
+            days.insert(f.day, f);
+        while (!days.isEmpty() && days.firstKey() < oldest)
+            days.erase(days.begin());
+    }
+    last = parsed.first().current;
+    return true;
+}
+
+void WeatherClient::onFinished(QNetworkReply *reply) {
+    inFlight = nullptr;
+    reply->deleteLater(); // 释放内存
+    // 一次往返：从发请求到回调 (含缓存命中和 304)
+    if (fetchStarted >= 0)
+        Tracer::record("weather.fetch", fetchStarted, Tracer::now());
+    TraceSpan span("weather.apply");
+
+    bool ok = false;
+    if (reply->error() == QNetworkReply::NoError) {
+        const QByteArray body = reply->readAll();
+        ok = apply(body, QDateTime::currentDateTime());
+        if (ok) {
+            QSaveFile out(lastResponsePath);
+            if (out.open(QIODevice::WriteOnly)) {
+                out.write(body);
+                out.commit();
+            }
+        }
+    }
+
+    if (ok) {
+        failures = 0;
+    } else {
+        ++failures;
+        scheduleRetry();
+    }
+    emit readingChanged(last, ok);
+}
+
+void WeatherClient::scheduleRetry() {
+    // 指数退避：30s, 60s, 120s ... 封顶 1 小时；再在后一半区间里随机取一点，免得大家同时重试
+    const int shift = qMin(failures - 1, 16);
+    const qint64 delay = qMin<qint64>(qint64(RETRY_BASE_MS) << shift, RETRY_MAX_MS);
+    const qint64 jittered = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    if (paused) {
+        retryPending = true;
+        return;
+    }
+    retryTimer->start(static_cast<int>(jittered));
+}
+
+void WeatherClient::pauseRetries() {
+    paused = true;
+    if (retryTimer->isActive()) {
+        retryTimer->stop();
+        retryPending = true;
+    }
+}
+
+void WeatherClient::resumeRetries() {
+    paused = false;
+    if (retryPending)
+        fetch();
+}
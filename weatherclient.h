@@ -0,0 +1,78 @@
+#ifndef WEATHERCLIENT_H
+#define WEATHERCLIENT_H
+
+#include <QMap>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include "weatherparser.h"
+
+// 一个要查天气的地点
+struct WeatherLocation {
+    QString name;
+    double latitude = 0;
+    double longitude = 0;
+};
+
+// --- 天气客户端 ---
+// * 所有地点 (设置项 weatherLocations，每项 "名称,纬度,经度") 合成一个请求，坐标用逗号分隔，
+//   一次拿回每个地点的实时天气和未来 16 天的逐日预报；
+// * 逐日预报按 地点 x 日期 存在内存里，任务截止日期的天气直接查表，不再发请求；
+// * QNetworkAccessManager 挂了 QNetworkDiskCache：遵守 Cache-Control，过期后用 ETag / Last-Modified 发条件请求，
+//   缓存还新鲜时根本不走网络；
+// * 上一次成功的响应原样存在缓存目录里，启动时先解析它顶上，不用等网络；
+// * 失败后按指数退避 + 随机抖动重试 (30 秒起，最多 1 小时)，不再干等整点定时器；
+// * 接口地址可以在设置里改 (weatherBaseUrl)，方便指向本地假服务器做测试。
+class WeatherClient : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit WeatherClient(QObject *parent = nullptr);
+
+    // 第一个地点的实时天气 (标签上显示的那个)
+    WeatherReading lastReading() const { return last; }
+
+    int locationCount() const { return locations.size(); }
+    QString locationName(int location) const { return locations[location].name; }
+    // 某地某天的预报，只查内存
+    bool forecast(int location, qint32 day, DailyForecast *out) const;
+
+    void fetch();
+    // 窗口藏起来时暂停重试；恢复时如果有重试欠着就立刻补一次
+    void pauseRetries();
+    void resumeRetries();
+    void clearConnectionCache() { net->clearConnectionCache(); }
+    // 同步也走这个 (共用连接池和代理设置)
+    QNetworkAccessManager *network() const { return net; }
+
+  signals:
+    // fresh 为 false：这次请求失败了，reading 是之前保存的旧数据 (可能无效)
+    void readingChanged(const WeatherReading &reading, bool fresh);
+
+  private:
+    void loadLocations();
+    QUrl requestUrl() const;
+    void onFinished(QNetworkReply *reply);
+    bool apply(const QByteArray &body, const QDateTime &fetchedAt); // 解析成功才返回 true
+    void scheduleRetry();
+
+    QNetworkAccessManager *net;
+    QNetworkReply *inFlight = nullptr;
+    qint64 fetchStarted = -1; // 跟踪用 (Tracer 纳秒)
+    QTimer *retryTimer;
+    int failures = 0;
+    bool paused = false;
+    bool retryPending = false; // 暂停期间到期的重试
+
+    QString baseUrl;
+    QString lastResponsePath; // 上一次成功的响应 (离线兜底)
+    QVector<WeatherLocation> locations;
+    QVector<QMap<qint32, DailyForecast>> daily; // 下标同 locations，键是儒略日
+    WeatherReading last;
+};
+
+#endif // WEATHERCLIENT_H
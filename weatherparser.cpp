@@ -0,0 +1,51 @@
+#include "weatherparser.h"
+#include <QDate>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+static LocationForecast parseLocation(const QJsonObject &obj, const QDateTime &fetchedAt) {
+    LocationForecast loc;
+    loc.latitude = obj["latitude"].toDouble();
+    loc.longitude = obj["longitude"].toDouble();
+
+    const QJsonObject current = obj["current_weather"].toObject();
+    if (current.contains("weathercode")) {
+        loc.current.temperature = current["temperature"].toDouble();
+        loc.current.code = current["weathercode"].toInt();
+        loc.current.fetchedAt = fetchedAt;
+    }
+
+    // daily 是按列存的：time[i] 对应 weathercode[i]、temperature_2m_max[i]...
+    const QJsonObject daily = obj["daily"].toObject();
+    const QJsonArray times = daily["time"].toArray();
+    const QJsonArray codes = daily["weathercode"].toArray();
+    const QJsonArray maxes = daily["temperature_2m_max"].toArray();
+    const QJsonArray mins = daily["temperature_2m_min"].toArray();
+    loc.daily.reserve(times.size());
+    for (int i = 0; i < times.size(); ++i) {
+        const QDate date = QDate::fromString(times[i].toString(), Qt::ISODate);
+        if (!date.isValid())
+            continue;
+        DailyForecast f;
+        f.day = static_cast<qint32>(date.toJulianDay());
+        f.code = codes.at(i).toInt(-1);
+        f.tempMax = maxes.at(i).toDouble();
+        f.tempMin = mins.at(i).toDouble();
+        loc.daily.append(f);
+    }
+    return loc;
+}
+
+QVector<LocationForecast> WeatherParser::parse(const QByteArray &json, const QDateTime &fetchedAt) {
+    QVector<LocationForecast> result;
+    const QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (doc.isObject()) {
+        result.append(parseLocation(doc.object(), fetchedAt));
+    } else if (doc.isArray()) {
+        const QJsonArray array = doc.array();
+        for (const QJsonValue &value : array)
+            result.append(parseLocation(value.toObject(), fetchedAt));
+    }
+    return result;
+}
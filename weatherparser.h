@@ -0,0 +1,42 @@
+#ifndef WEATHERPARSER_H
+#define WEATHERPARSER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QVector>
+
+// 一次天气读数
+struct WeatherReading {
+    double temperature = 0;
+    int code = -1;       // WMO 天气代码，-1 表示没有数据
+    QDateTime fetchedAt; // 拿到这份数据的时间
+
+    bool isValid() const { return code >= 0; }
+};
+
+// 某一天的预报
+struct DailyForecast {
+    qint32 day = 0; // 儒略日
+    int code = -1;
+    double tempMin = 0;
+    double tempMax = 0;
+};
+
+// 一个地点的全部数据
+struct LocationForecast {
+    double latitude = 0;
+    double longitude = 0;
+    WeatherReading current; // 没请求 current_weather 时无效
+    QVector<DailyForecast> daily;
+};
+
+// --- Open-Meteo 响应解析 ---
+// 纯函数，不碰网络，离线拿保存下来的响应就能跑。
+// 单个坐标时响应是一个对象，多个坐标 (逗号分隔) 时是对象数组，顺序和请求里的坐标一致。
+class WeatherParser {
+  public:
+    // 解析失败返回空表；fetchedAt 写进每个地点的 current
+    static QVector<LocationForecast> parse(const QByteArray &json, const QDateTime &fetchedAt = QDateTime());
+};
+
+#endif // WEATHERPARSER_H